@@ -0,0 +1,108 @@
+#include "classifier/classifier.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+template<typename eT>
+arma::Col<ocr::label_t> ocr::BasicClassifier<eT>::test(
+	const arma::Mat<eT> &test_vectors ) {
+	arma::Col<ocr::label_t> predicted_labels;
+	test_batch(test_vectors, predicted_labels);
+	return predicted_labels;
+}
+
+template<typename eT>
+void ocr::BasicClassifier<eT>::test_batch( const arma::Mat<eT> &test_vectors,
+	arma::Col<ocr::label_t> &predicted_labels, arma::Col<eT> *distances,
+	arma::Col<eT> *confidence ) {
+
+	predicted_labels.set_size(test_vectors.n_cols);
+	if ( distances == nullptr && confidence == nullptr ) {
+		ocr::utilities::parallel_for(test_vectors.n_cols, this->num_threads_,
+			[&](size_t first, size_t last) {
+				for ( size_t i = first; i < last; i++ ) {
+					predicted_labels[i] = predict(test_vectors.unsafe_col(i));
+				}
+			});
+		return;
+	}
+
+	// A score that was not requested is still computed, into scratch space
+	arma::Col<eT> unused_distances;
+	arma::Col<eT> unused_confidence;
+	arma::Col<eT> &entry_distances =
+		( distances != nullptr ) ? *distances : unused_distances;
+	arma::Col<eT> &entry_confidence =
+		( confidence != nullptr ) ? *confidence : unused_confidence;
+	entry_distances.set_size(test_vectors.n_cols);
+	entry_confidence.set_size(test_vectors.n_cols);
+
+	ocr::utilities::parallel_for(test_vectors.n_cols, this->num_threads_,
+		[&](size_t first, size_t last) {
+			for ( size_t i = first; i < last; i++ ) {
+				predicted_labels[i] = predict_scored(test_vectors.unsafe_col(i),
+					entry_distances[i], entry_confidence[i]);
+			}
+		});
+}
+
+template<typename eT>
+double ocr::BasicClassifier<eT>::validate( const arma::Mat<eT> &test_vectors,
+	const arma::Col<ocr::label_t> &real_labels,
+	arma::Col<ocr::label_t> *predicted_labels) {
+
+	arma::Col<ocr::label_t> test_labels;
+	test_batch(test_vectors, test_labels);
+	const size_t errors = arma::accu(test_labels != real_labels);
+
+	if ( predicted_labels != nullptr ) {
+		*predicted_labels = test_labels;
+	}
+
+	return 1.0*errors/test_vectors.n_cols;
+}
+
+template<typename eT>
+double ocr::BasicClassifier<eT>::validate( ocr::BasicDatasetStream<eT> &stream,
+	arma::Col<ocr::label_t> *predicted_labels ) {
+
+	if ( !stream.is_open() || !stream.has_labels() ) {
+		throw std::invalid_argument("validation requires an open, labelled stream");
+	}
+
+	if ( predicted_labels != nullptr ) {
+		predicted_labels->set_size(stream.num_entries());
+	}
+
+	arma::Mat<eT> batch;
+	arma::Col<ocr::label_t> real_labels;
+	arma::Col<ocr::label_t> test_labels;
+	size_t errors = 0;
+	size_t first = 0;
+
+	stream.reset();
+	while ( stream.next(batch, &real_labels) ) {
+		test_batch(batch, test_labels);
+		errors += arma::accu(test_labels != real_labels);
+
+		if ( predicted_labels != nullptr ) {
+			std::copy(test_labels.begin(), test_labels.end(),
+				predicted_labels->begin() + first);
+		}
+		first += batch.n_cols;
+	}
+
+	return first > 0 ? 1.0*errors/first : 0.0;
+}
+
+template<typename eT>
+ocr::label_t ocr::BasicClassifier<eT>::predict_scored(
+	const arma::Col<eT> &predict_vector, eT &distance, eT &confidence ) {
+	distance = std::numeric_limits<eT>::quiet_NaN();
+	confidence = std::numeric_limits<eT>::quiet_NaN();
+	return predict(predict_vector);
+}
+
+template class ocr::BasicClassifier<double>;
+template class ocr::BasicClassifier<float>;
@@ -3,8 +3,10 @@
 
 #include <armadillo>
 
+#include "parser/dataset_stream.h"
 #include "util/serialize.h"
 #include "util/ocrtypes.h"
+#include "util/parallel.h"
 
 namespace ocr {
 
@@ -15,9 +17,12 @@ namespace ocr {
  * The ClassifierInterface class defines methods to train the classifier with
  * a training dataset as well as methods to test the classifier against a
  * dataset of size one or more. The class also incorporates methods for
- * serialization.
+ * serialization. The interface is templated on the element type of the
+ * entries; ClassifierInterface classifies doubles and FClassifierInterface
+ * floats.
  */
-class ClassifierInterface {
+template<typename eT>
+class BasicClassifier {
 
 protected:
 	/**
@@ -27,10 +32,10 @@ protected:
 	 * to ensure that no unwitting developer accidently attempts to use it to
 	 * to create an object.
 	 */
-	ClassifierInterface() {}
+	BasicClassifier() : num_threads_(1) {}
 
 public:
-	virtual ~ClassifierInterface() {}
+	virtual ~BasicClassifier() {}
 
 
 	/**
@@ -43,9 +48,23 @@ public:
 	 * @param[in] data_set nxm matrix with each entry in a column
 	 * @param[in] label_set mx1 vector of data_set labels
 	 */
-	virtual void train( const arma::mat &data_set,
+	virtual void train( const arma::Mat<eT> &data_set,
 						const arma::Col<label_t> &label_set ) = 0;
 
+	/**
+	 * Trains the classifier given a dataset and labels moved into it
+	 *
+	 * Classifiers that store the training set take over the memory of the
+	 * arguments rather than copying it, which are left empty. The default
+	 * implementation copies them through train.
+	 *
+	 * @param[in] data_set nxm matrix with each entry in a column
+	 * @param[in] label_set mx1 vector of data_set labels
+	 */
+	virtual void train( arma::Mat<eT> &&data_set, arma::Col<label_t> &&label_set ) {
+		train(data_set, label_set);
+	}
+
 	/**
 	 * Predict the label of a single vector.
 	 *
@@ -59,7 +78,7 @@ public:
 	 *   vector
 	 *
 	 */
-	virtual label_t predict( const arma::vec &predict_vector ) = 0;
+	virtual label_t predict( const arma::Col<eT> &predict_vector ) = 0;
 
 	/**
 	 * Predict the labels of several vectors.
@@ -67,14 +86,42 @@ public:
 	 * Uses the trained algorithm to determine the label of each n-dimensional
 	 * column vector in a nxm matrix of entries where each entry is stored in
 	 * a column. This method assumes that the training method has already been
-	 * completed.
+	 * completed. The labels are computed by test_batch.
 	 *
 	 * @param[in] test_mat nxm matrix with each entry in a column
 	 *
 	 * @return column vector of classification labels (defined by type label_t)
 	 *   where each i-th entry corresponds to the i-th column of the input
 	 */
-	virtual label_t* test( const arma::mat &test_mat ) = 0;
+	arma::Col<label_t> test( const arma::Mat<eT> &test_mat );
+
+	/**
+	 * Predict the labels of several vectors, with optional scores.
+	 *
+	 * Writes the label of each column of a nxm matrix of entries into a
+	 * caller-provided vector, which is resized to m and can be reused across
+	 * calls. The distance of each entry to the training set and a confidence
+	 * in [0, 1] for its label are computed only when requested; their exact
+	 * meaning is given by each classifier, and classifiers that do not
+	 * measure them report NaN.
+	 *
+	 * The default implementation calls predict (or predict_scored, when
+	 * scores are requested) on each column, splitting the columns across the
+	 * number of threads set by set_num_threads. Each label is written to the
+	 * position of its column, so the output is identical for any number of
+	 * threads. Classifiers that can process the whole batch at once, such as
+	 * with matrix products, override this method.
+	 *
+	 * @param[in] test_mat nxm matrix with each entry in a column
+	 * @param[out] labels mx1 vector of classification labels
+	 * @param[out] distances optional mx1 vector of distances to the training
+	 *   set
+	 * @param[out] confidence optional mx1 vector of label confidences
+	 */
+	virtual void test_batch( const arma::Mat<eT> &test_mat,
+							 arma::Col<label_t> &labels,
+							 arma::Col<eT> *distances = nullptr,
+							 arma::Col<eT> *confidence = nullptr );
 
 	/**
 	 * Determine the error rate for a given test set
@@ -90,12 +137,73 @@ public:
 	 *
 	 * @return fractional error rate
 	 */
-	virtual double validate( const arma::mat &test_mat,
+	virtual double validate( const arma::Mat<eT> &test_mat,
 						const arma::Col<label_t> &true_labels,
-						arma::Col<label_t> *predicted_labels = nullptr	) = 0;
+						arma::Col<label_t> *predicted_labels = nullptr	);
+
+	/**
+	 * Determine the error rate for a streamed test set
+	 *
+	 * Reads the test set one batch at a time and calls test_batch on each
+	 * batch, so that only a single batch of the test set is held in memory.
+	 * The stream is rewound before it is read.
+	 *
+	 * @param[in] stream labelled stream of test entries
+	 * @param[out] predicted_labels mx1 column vector of predicted labels
+	 *
+	 * @return fractional error rate
+	 */
+	double validate( BasicDatasetStream<eT> &stream,
+					 arma::Col<label_t> *predicted_labels = nullptr );
+
+	/**
+	 * Set the number of worker threads used by test and validate
+	 *
+	 * Queries are split into contiguous ranges of columns, one per thread.
+	 * A value of 0 uses one thread per hardware core. Classifiers whose
+	 * predict method is not safe to call concurrently must keep the default
+	 * of a single thread.
+	 *
+	 * @param[in] num_threads number of worker threads (0 = all cores)
+	 */
+	void set_num_threads(size_t num_threads) {
+		this->num_threads_ = num_threads;
+	}
+
+	/**
+	 * Returns the number of worker threads used by test and validate
+	 *
+	 * @return number of worker threads (0 = all cores)
+	 */
+	size_t get_num_threads() const {
+		return this->num_threads_;
+	}
+
+protected:
+	/**
+	 * Predict the label of a single vector along with its scores
+	 *
+	 * Called by the default test_batch when distances or confidences are
+	 * requested. The default implementation calls predict and reports NaN
+	 * for both scores.
+	 *
+	 * @param[in] predict_vector nx1 vector, whose label is desired
+	 * @param[out] distance distance of the vector to the training set
+	 * @param[out] confidence confidence in [0, 1] of the returned label
+	 *
+	 * @return classification label (defined by type label_t) of the input
+	 *   vector
+	 */
+	virtual label_t predict_scored( const arma::Col<eT> &predict_vector,
+									eT &distance, eT &confidence );
+
+	size_t num_threads_; /// Worker threads used by test and validate
 
 };
 
+typedef BasicClassifier<double> ClassifierInterface;
+typedef BasicClassifier<float> FClassifierInterface;
+
 }
 
 #endif // OCR_CLASSIFIER_CLASSIFIER_H_
\ No newline at end of file
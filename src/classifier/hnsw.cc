@@ -0,0 +1,272 @@
+#include "classifier/hnsw.h"
+
+namespace {
+	// Marks of the entries visited by the current search of this thread. Each
+	// search uses a new tag, so the marks never need to be cleared.
+	thread_local std::vector<uint32_t> visited_marks;
+	thread_local uint32_t visited_tag = 0;
+}
+
+ocr::HNSW::HNSW( ocr::Metric *metric, uint32_t k, uint32_t m,
+	uint32_t ef_construction, uint32_t ef_search ) {
+	if ( k == 0 ) {
+		throw std::invalid_argument("k must be positive");
+	}
+	if ( m < 2 ) {
+		throw std::invalid_argument("m must be at least 2");
+	}
+
+	this->metric_ = metric;
+	this->k_ = k;
+	this->m_ = m;
+	this->ef_construction_ = std::max(ef_construction, m);
+	this->ef_search_ = std::max(ef_search, k);
+	this->level_multiplier_ = 1/std::log(1.0*m);
+	this->entry_point_ = 0;
+	this->max_level_ = 0;
+}
+
+void ocr::HNSW::train( const arma::mat &training_set,
+	const arma::Col<ocr::label_t> &training_labels ) {
+
+	this->points_ = training_set;
+	this->labels_ = training_labels;
+
+	const size_t n = training_set.n_cols;
+	this->levels_ = std::vector<uint32_t>(n);
+	this->links_ = std::vector<std::vector<LinkList>>(n);
+	this->link_mutexes_.reset(new std::mutex[n]);
+	if ( n == 0 ) {
+		return;
+	}
+
+	// The layers are drawn up front, so the layer of each entry does not
+	// depend on the order in which the threads insert them
+	std::mt19937 generator = std::mt19937(0);
+	std::uniform_real_distribution<double> uniform(0., 1.);
+	for ( size_t i = 0; i < n; i++ ) {
+		this->levels_[i] = (uint32_t)(-std::log(1. - uniform(generator))
+			* this->level_multiplier_);
+		this->links_[i].resize(this->levels_[i] + 1);
+	}
+
+	this->entry_point_ = 0;
+	this->max_level_ = this->levels_[0];
+
+	std::atomic<size_t> next(1);
+	size_t num_threads = ocr::utilities::resolve_threads(this->num_threads_);
+	ocr::utilities::parallel_for(num_threads, num_threads,
+		[&](size_t, size_t) {
+			for ( size_t i = next++; i < n; i = next++ ) {
+				insert(i);
+			}
+		});
+}
+
+ocr::label_t ocr::HNSW::predict( const arma::vec &predict_vector ) {
+	std::vector<ocr::Neighbor> neighbors = nearest_neighbors(predict_vector);
+	return ocr::majority_vote(neighbors, this->labels_);
+}
+
+ocr::label_t ocr::HNSW::predict_scored( const arma::vec &predict_vector,
+	double &distance, double &confidence ) {
+	std::vector<ocr::Neighbor> neighbors = nearest_neighbors(predict_vector);
+	ocr::label_t label = ocr::majority_vote(neighbors, this->labels_);
+
+	size_t nearest;
+	confidence = ocr::label_share(neighbors, this->labels_, label, nearest);
+	distance = this->metric_->distance(predict_vector,
+		this->points_.unsafe_col(neighbors[nearest].index));
+	return label;
+}
+
+std::vector<ocr::Neighbor> ocr::HNSW::nearest_neighbors(
+	const arma::vec &query ) {
+
+	if ( this->points_.n_cols == 0 ) {
+		return std::vector<ocr::Neighbor>();
+	}
+
+	ocr::Neighbor current = {distance(query, this->entry_point_),
+		this->entry_point_};
+	for ( uint32_t layer = this->max_level_; layer > 0; layer-- ) {
+		current = greedy_search(query, current, layer);
+	}
+
+	std::vector<ocr::Neighbor> neighbors =
+		search_layer(query, current, std::max(this->ef_search_, this->k_), 0);
+	if ( neighbors.size() > this->k_ ) {
+		neighbors.resize(this->k_);
+	}
+	return neighbors;
+}
+
+void ocr::HNSW::set_ef_search(uint32_t ef_search) {
+	this->ef_search_ = std::max(ef_search, this->k_);
+}
+
+uint32_t ocr::HNSW::get_ef_search() const {
+	return this->ef_search_;
+}
+
+std::vector<ocr::Neighbor> ocr::HNSW::search_layer( const arma::vec &query,
+	const ocr::Neighbor &entry, size_t ef, uint32_t layer ) {
+
+	if ( visited_marks.size() < this->points_.n_cols ) {
+		visited_marks.assign(this->points_.n_cols, 0);
+		visited_tag = 0;
+	}
+	if ( ++visited_tag == 0 ) {
+		std::fill(visited_marks.begin(), visited_marks.end(), 0);
+		visited_tag = 1;
+	}
+
+	auto farther = [](const ocr::Neighbor &a, const ocr::Neighbor &b) {
+		return b < a;
+	};
+	std::vector<ocr::Neighbor> candidates = {entry};
+	ocr::NeighborHeap results = ocr::NeighborHeap(ef);
+	results.push(entry.distance, entry.index);
+	visited_marks[entry.index] = visited_tag;
+
+	while ( !candidates.empty() ) {
+		std::pop_heap(candidates.begin(), candidates.end(), farther);
+		ocr::Neighbor candidate = candidates.back();
+		candidates.pop_back();
+		if ( candidate.distance > results.bound() ) {
+			break;
+		}
+
+		for ( uint32_t neighbor : links(candidate.index, layer) ) {
+			if ( visited_marks[neighbor] == visited_tag ) {
+				continue;
+			}
+			visited_marks[neighbor] = visited_tag;
+
+			double d = distance(query, neighbor);
+			if ( results.push(d, neighbor) ) {
+				candidates.push_back(ocr::Neighbor{d, neighbor});
+				std::push_heap(candidates.begin(), candidates.end(), farther);
+			}
+		}
+	}
+
+	return results.sorted();
+}
+
+ocr::Neighbor ocr::HNSW::greedy_search( const arma::vec &query,
+	ocr::Neighbor entry, uint32_t layer ) {
+
+	bool changed = true;
+	while ( changed ) {
+		changed = false;
+		for ( uint32_t neighbor : links(entry.index, layer) ) {
+			double d = distance(query, neighbor);
+			if ( d < entry.distance ) {
+				entry = ocr::Neighbor{d, neighbor};
+				changed = true;
+			}
+		}
+	}
+
+	return entry;
+}
+
+std::vector<ocr::Neighbor> ocr::HNSW::select_neighbors(
+	std::vector<ocr::Neighbor> candidates, size_t max_links ) {
+
+	std::sort(candidates.begin(), candidates.end());
+
+	std::vector<ocr::Neighbor> selected;
+	for ( const ocr::Neighbor &candidate : candidates ) {
+		if ( selected.size() >= max_links ) {
+			break;
+		}
+
+		bool diverse = true;
+		const arma::vec point = this->points_.unsafe_col(candidate.index);
+		for ( const ocr::Neighbor &kept : selected ) {
+			if ( distance(point, kept.index) < candidate.distance ) {
+				diverse = false;
+				break;
+			}
+		}
+		if ( diverse ) {
+			selected.push_back(candidate);
+		}
+	}
+
+	return selected;
+}
+
+void ocr::HNSW::insert( uint32_t index ) {
+	const arma::vec query = this->points_.col(index);
+	const uint32_t level = this->levels_[index];
+
+	// An entry reaching above the current top layer becomes the new entry
+	// point, so the lock is held for its whole insertion
+	std::unique_lock<std::mutex> entry_lock(this->entry_mutex_);
+	const uint32_t max_level = this->max_level_;
+	const uint32_t entry_point = this->entry_point_;
+	if ( level <= max_level ) {
+		entry_lock.unlock();
+	}
+
+	ocr::Neighbor current = {distance(query, entry_point), entry_point};
+	for ( uint32_t layer = max_level; layer > level; layer-- ) {
+		current = greedy_search(query, current, layer);
+	}
+
+	for ( int64_t layer = std::min(level, max_level); layer >= 0; layer-- ) {
+		std::vector<ocr::Neighbor> candidates = search_layer(query, current,
+			this->ef_construction_, layer);
+		std::vector<ocr::Neighbor> selected = select_neighbors(candidates,
+			this->m_);
+
+		{
+			std::lock_guard<std::mutex> lock(this->link_mutexes_[index]);
+			LinkList &own_links = this->links_[index][layer];
+			for ( const ocr::Neighbor &neighbor : selected ) {
+				own_links.push_back(neighbor.index);
+			}
+		}
+
+		const size_t max_links = ( layer == 0 ) ? 2*this->m_ : this->m_;
+		for ( const ocr::Neighbor &neighbor : selected ) {
+			std::lock_guard<std::mutex> lock(this->link_mutexes_[neighbor.index]);
+			LinkList &neighbor_links = this->links_[neighbor.index][layer];
+			if ( neighbor_links.size() < max_links ) {
+				neighbor_links.push_back(index);
+				continue;
+			}
+
+			// Reselect the links of a full neighbor among its current links
+			// and the new entry
+			const arma::vec point = this->points_.unsafe_col(neighbor.index);
+			std::vector<ocr::Neighbor> options = {{neighbor.distance, index}};
+			for ( uint32_t link : neighbor_links ) {
+				options.push_back(ocr::Neighbor{distance(point, link), link});
+			}
+			neighbor_links.clear();
+			for ( const ocr::Neighbor &option : select_neighbors(options, max_links) ) {
+				neighbor_links.push_back(option.index);
+			}
+		}
+
+		current = candidates[0];
+	}
+
+	if ( level > max_level ) {
+		this->entry_point_ = index;
+		this->max_level_ = level;
+	}
+}
+
+ocr::HNSW::LinkList ocr::HNSW::links( uint32_t index, uint32_t layer ) {
+	std::lock_guard<std::mutex> lock(this->link_mutexes_[index]);
+	return this->links_[index][layer];
+}
+
+double ocr::HNSW::distance( const arma::vec &query, uint32_t index ) {
+	return this->metric_->rank_distance(query, this->points_.unsafe_col(index));
+}
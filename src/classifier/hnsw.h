@@ -0,0 +1,201 @@
+#ifndef OCR_CLASSIFIER_HNSW_H_
+#define OCR_CLASSIFIER_HNSW_H_
+
+#include "classifier/classifier.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include "classifier/neighbor_heap.h"
+#include "classifier/voting.h"
+#include "metric/metric.h"
+#include "metric/pnorm_metric.h"
+#include "util/ocrtypes.h"
+
+namespace ocr {
+
+/**
+ * An approximate k-Nearest-Neighbor classifier using a Hierarchical
+ * Navigable Small World (HNSW) graph.
+ *
+ * Builds the layered proximity graph of Malkov & Yashunin when trained.
+ * Every training entry is assigned a random top layer, with exponentially
+ * fewer entries on higher layers, and is linked to its nearest entries on
+ * each layer up to its top. A query descends greedily from the top layer and
+ * runs a best-first search of width ef_search on the bottom layer, so its
+ * cost grows roughly logarithmically with the training set size. The result
+ * is approximate; recall is traded against latency with ef_search.
+ *
+ * The graph is built on the number of threads set by set_num_threads.
+ */
+class HNSW : public ClassifierInterface {
+public:
+	/**
+	 * Constructor for the HNSW classifier
+	 *
+	 * @param[in] metric distance used to compare entries
+	 * @param[in] k number of neighbors that vote on a label
+	 * @param[in] m number of links per entry on each layer above the bottom
+	 *   (twice as many on the bottom layer)
+	 * @param[in] ef_construction width of the search used to link entries
+	 * @param[in] ef_search width of the search used to answer queries
+	 */
+	HNSW( Metric *metric = new PNorm(), uint32_t k = 1, uint32_t m = 16,
+		  uint32_t ef_construction = 200, uint32_t ef_search = 50 );
+	~HNSW() {}
+
+	/**
+	 * Trains the classifier given a dataset and known labels for the set
+	 *
+	 * Inserts every training entry into the graph. Layers are drawn from a
+	 * seeded generator before the insertion starts, and entries are inserted
+	 * concurrently by the threads set with set_num_threads.
+	 *
+	 * @param[in] data_set nxm matrix with each entry in a column
+	 * @param[in] label_set mx1 vector of data_set labels
+	 */
+	void train(const arma::mat &data_set, const arma::Col<label_t> &label_set);
+	// Moved datasets are taken by the base class and trained on as above
+	using ClassifierInterface::train;
+
+	/**
+	 * Predict the label of a single vector.
+	 *
+	 * Finds the approximate k nearest training entries and returns the label
+	 * held by most of them, breaking ties in favor of the nearest entry.
+	 *
+	 * @param[in] predict_vector nx1 vector, whose label is desired
+	 *
+	 * @return classification label (defined by type label_t) of the input
+	 *   vector
+	 */
+	label_t predict( const arma::vec &predict_vector );
+
+	/**
+	 * Find the approximate k nearest training entries of a vector
+	 *
+	 * @param[in] query nx1 vector whose neighbors are desired
+	 *
+	 * @return up to k neighbors ordered from nearest to farthest, with
+	 *   indices into the columns of the training set and distances given by
+	 *   Metric::rank_distance
+	 */
+	std::vector<Neighbor> nearest_neighbors( const arma::vec &query );
+
+	/**
+	 * Set the width of the search used to answer queries
+	 *
+	 * Larger values raise the recall at the cost of latency. Values below k
+	 * are raised to k. Takes effect without retraining.
+	 *
+	 * @param[in] ef_search number of candidates kept during a query
+	 */
+	void set_ef_search(uint32_t ef_search);
+
+	/**
+	 * Returns the width of the search used to answer queries
+	 */
+	uint32_t get_ef_search() const;
+
+protected:
+	/**
+	 * Predict the label of a single vector along with its scores
+	 *
+	 * The distance is that of the nearest neighbor found holding the label,
+	 * and the confidence is the fraction of the neighbors found holding it.
+	 *
+	 * @param[in] predict_vector nx1 vector, whose label is desired
+	 * @param[out] distance distance to the nearest neighbor holding the label
+	 * @param[out] confidence fraction of the neighbors holding the label
+	 *
+	 * @return classification label (defined by type label_t) of the input
+	 *   vector
+	 */
+	label_t predict_scored( const arma::vec &predict_vector, double &distance,
+							double &confidence );
+
+private:
+	typedef std::vector<uint32_t> LinkList;
+
+	/**
+	 * Best-first search of a single layer
+	 *
+	 * @param[in] query nx1 query vector
+	 * @param[in] entry entry point of the search
+	 * @param[in] ef number of candidates to keep
+	 * @param[in] layer layer to search
+	 *
+	 * @return up to ef closest entries found, in no particular order
+	 */
+	std::vector<Neighbor> search_layer( const arma::vec &query,
+		const Neighbor &entry, size_t ef, uint32_t layer );
+
+	/**
+	 * Greedy descent to the closest entry on a layer
+	 *
+	 * @param[in] query nx1 query vector
+	 * @param[in] entry starting entry
+	 * @param[in] layer layer to search
+	 *
+	 * @return local minimum of the distance reached from entry
+	 */
+	Neighbor greedy_search( const arma::vec &query, Neighbor entry,
+		uint32_t layer );
+
+	/**
+	 * Choose the links of an entry among candidates
+	 *
+	 * Applies the neighbor selection heuristic of Malkov & Yashunin: taking
+	 * candidates from nearest to farthest, a candidate is kept only if it is
+	 * closer to the entry than to every candidate kept so far. This favors
+	 * links in diverse directions over clusters of near-duplicates.
+	 *
+	 * @param[in] candidates candidates with their distance to the entry
+	 * @param[in] max_links maximum number of links
+	 *
+	 * @return selected candidates
+	 */
+	std::vector<Neighbor> select_neighbors( std::vector<Neighbor> candidates,
+		size_t max_links );
+
+	/**
+	 * Insert a training entry into the graph
+	 *
+	 * @param[in] index column of the entry in the training set
+	 */
+	void insert( uint32_t index );
+
+	/**
+	 * Returns a copy of the links of an entry on a layer
+	 */
+	LinkList links( uint32_t index, uint32_t layer );
+
+	/**
+	 * Returns the rank distance from a vector to a training entry
+	 */
+	double distance( const arma::vec &query, uint32_t index );
+
+	Metric *metric_; /// Distance between entries
+	uint32_t k_; /// Number of voting neighbors
+	uint32_t m_; /// Links per entry above the bottom layer
+	uint32_t ef_construction_; /// Search width while building
+	uint32_t ef_search_; /// Search width while querying
+	double level_multiplier_; /// Scale of the random layer distribution
+
+	arma::mat points_; /// Training entries
+	arma::Col<label_t> labels_; /// Labels of the training entries
+	std::vector<uint32_t> levels_; /// Top layer of each entry
+	std::vector<std::vector<LinkList>> links_; /// Links per entry and layer
+	std::unique_ptr<std::mutex[]> link_mutexes_; /// Guard links_ per entry
+
+	std::mutex entry_mutex_; /// Guards entry_point_ and max_level_
+	uint32_t entry_point_; /// Entry of the top layer
+	uint32_t max_level_; /// Highest layer in the graph
+};
+
+}
+
+#endif // OCR_CLASSIFIER_HNSW_H_
@@ -0,0 +1,58 @@
+#include "classifier/k_nearest_neighbor.h"
+
+ocr::KNearestNeighbor::KNearestNeighbor( uint32_t k, ocr::Metric *metric,
+	ocr::VotingRule rule ) {
+	if ( k == 0 ) {
+		throw std::invalid_argument("k must be positive");
+	}
+
+	this->k_ = k;
+	this->metric_ = metric;
+	this->rule_ = rule;
+}
+
+void ocr::KNearestNeighbor::train( const arma::mat &training_set,
+	const arma::Col<ocr::label_t> &training_labels ) {
+
+	this->training_set_ = training_set;
+	this->training_labels_ = training_labels;
+}
+
+ocr::label_t ocr::KNearestNeighbor::predict( const arma::vec &predict_vector ) {
+	std::vector<ocr::Neighbor> neighbors = nearest_neighbors(predict_vector);
+	return ocr::vote(neighbors, this->training_labels_, this->rule_);
+}
+
+ocr::label_t ocr::KNearestNeighbor::predict_scored( const arma::vec &predict_vector,
+	double &distance, double &confidence ) {
+	std::vector<ocr::Neighbor> neighbors = nearest_neighbors(predict_vector);
+	ocr::label_t label = ocr::vote(neighbors, this->training_labels_, this->rule_);
+
+	size_t nearest;
+	confidence = ocr::label_share(neighbors, this->training_labels_, label, nearest);
+	distance = neighbors[nearest].distance;
+	return label;
+}
+
+std::vector<ocr::Neighbor> ocr::KNearestNeighbor::nearest_neighbors(
+	const arma::vec &query ) {
+
+	ocr::NeighborHeap heap = ocr::NeighborHeap(this->k_);
+	for ( arma::uword i = 0; i < this->training_set_.n_cols; i++ ) {
+		heap.push(this->metric_->rank_distance(query,
+			this->training_set_.unsafe_col(i)), i);
+	}
+
+	// The scan ranks candidates by a surrogate of the distance; the true
+	// distance is only computed for the k neighbors that are kept
+	std::vector<ocr::Neighbor> neighbors = heap.sorted();
+	for ( auto &neighbor : neighbors ) {
+		neighbor.distance = this->metric_->distance(query,
+			this->training_set_.unsafe_col(neighbor.index));
+	}
+	return neighbors;
+}
+
+void ocr::KNearestNeighbor::set_voting_rule(ocr::VotingRule rule) {
+	this->rule_ = rule;
+}
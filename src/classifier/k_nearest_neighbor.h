@@ -0,0 +1,104 @@
+#ifndef OCR_CLASSIFIER_K_NEAREST_NEIGHBOR_H_
+#define OCR_CLASSIFIER_K_NEAREST_NEIGHBOR_H_
+
+#include "classifier/classifier.h"
+
+#include <vector>
+
+#include "classifier/neighbor_heap.h"
+#include "classifier/voting.h"
+#include "metric/metric.h"
+#include "metric/pnorm_metric.h"
+#include "util/ocrtypes.h"
+
+namespace ocr {
+
+/**
+ * A k-Nearest-Neighbor algorithm implementation.
+ *
+ * Scans the training set for the k entries closest to a query while keeping
+ * only the k best candidates in a bounded heap, and combines their labels
+ * with a VotingRule.
+ */
+class KNearestNeighbor : public ClassifierInterface {
+public:
+	/**
+	 * Constructor for k-nearest neighbor
+	 *
+	 * @param[in] k number of neighbors that vote on a label
+	 * @param[in] metric a metric specified by the Metric class
+	 * @param[in] rule rule combining the labels of the neighbors
+	 */
+	KNearestNeighbor( uint32_t k = 3, Metric *metric = new PNorm(),
+					  VotingRule rule = MAJORITY );
+	~KNearestNeighbor() {}
+
+	/**
+	 * Trains the classifier given a dataset and known labels for the set
+	 *
+	 * @param[in] data_set nxm matrix with each entry in a column
+	 * @param[in] label_set mx1 vector of data_set labels
+	 */
+	void train(const arma::mat &data_set, const arma::Col<label_t> &label_set);
+	// Moved datasets are taken by the base class and trained on as above
+	using ClassifierInterface::train;
+
+	/**
+	 * Predict the label of a single vector.
+	 *
+	 * Finds the k nearest training entries and combines their labels with
+	 * the voting rule.
+	 *
+	 * @param[in] predict_vector nx1 vector, whose label is desired
+	 *
+	 * @return classification label (defined by type label_t) of the input
+	 *   vector
+	 */
+	label_t predict( const arma::vec &predict_vector );
+
+	/**
+	 * Find the k nearest training entries of a vector
+	 *
+	 * @param[in] query nx1 vector whose neighbors are desired
+	 *
+	 * @return the k nearest neighbors ordered from nearest to farthest, with
+	 *   indices into the columns of the training set and distances given by
+	 *   Metric::distance
+	 */
+	std::vector<Neighbor> nearest_neighbors( const arma::vec &query );
+
+	/**
+	 * Set the rule combining the labels of the neighbors
+	 *
+	 * @param[in] rule voting rule
+	 */
+	void set_voting_rule(VotingRule rule);
+
+protected:
+	/**
+	 * Predict the label of a single vector along with its scores
+	 *
+	 * The distance is that of the nearest neighbor holding the label, and the
+	 * confidence is the fraction of the k neighbors holding it.
+	 *
+	 * @param[in] predict_vector nx1 vector, whose label is desired
+	 * @param[out] distance distance to the nearest neighbor holding the label
+	 * @param[out] confidence fraction of the neighbors holding the label
+	 *
+	 * @return classification label (defined by type label_t) of the input
+	 *   vector
+	 */
+	label_t predict_scored( const arma::vec &predict_vector, double &distance,
+							double &confidence );
+
+private:
+	uint32_t k_; /// Number of voting neighbors
+	Metric *metric_; /// Distance between entries
+	VotingRule rule_; /// Combines the labels of the neighbors
+	arma::mat training_set_;
+	arma::Col<label_t> training_labels_;
+};
+
+}
+
+#endif // OCR_CLASSIFIER_K_NEAREST_NEIGHBOR_H_
@@ -0,0 +1,143 @@
+#include "classifier/kd_tree.h"
+
+#include <cmath>
+
+ocr::KDTree::KDTree( uint32_t k, uint32_t p_value, arma::uword leaf_size )
+	: metric_(p_value) {
+	if ( k == 0 ) {
+		throw std::invalid_argument("k must be positive");
+	}
+
+	this->k_ = k;
+	this->leaf_size_ = std::max<arma::uword>(leaf_size, 1);
+}
+
+void ocr::KDTree::train( const arma::mat &training_set,
+	const arma::Col<ocr::label_t> &training_labels ) {
+
+	std::vector<arma::uword> order(training_set.n_cols);
+	for ( arma::uword i = 0; i < order.size(); i++ ) {
+		order[i] = i;
+	}
+
+	this->nodes_.clear();
+	if ( !order.empty() ) {
+		build(0, order.size(), order, training_set);
+	}
+
+	this->indices_ = arma::uvec(order);
+	this->points_ = training_set.cols(this->indices_);
+	this->labels_ = training_labels;
+}
+
+ocr::label_t ocr::KDTree::predict( const arma::vec &predict_vector ) {
+	std::vector<ocr::Neighbor> neighbors = nearest_neighbors(predict_vector);
+	return ocr::majority_vote(neighbors, this->labels_);
+}
+
+ocr::label_t ocr::KDTree::predict_scored( const arma::vec &predict_vector,
+	double &distance, double &confidence ) {
+	std::vector<ocr::Neighbor> neighbors = nearest_neighbors(predict_vector);
+	ocr::label_t label = ocr::majority_vote(neighbors, this->labels_);
+
+	size_t nearest;
+	confidence = ocr::label_share(neighbors, this->labels_, label, nearest);
+	// The neighbors hold the p-th power of the distance
+	distance = std::pow(neighbors[nearest].distance,
+		1./this->metric_.get_p_value());
+	return label;
+}
+
+std::vector<ocr::Neighbor> ocr::KDTree::nearest_neighbors(
+	const arma::vec &query ) {
+
+	ocr::NeighborHeap heap = ocr::NeighborHeap(this->k_);
+	if ( this->nodes_.empty() ) {
+		return heap.sorted();
+	}
+
+	arma::vec offsets = arma::zeros<arma::vec>(query.n_elem);
+	search(0, query, 0, offsets, heap);
+
+	std::vector<ocr::Neighbor> neighbors = heap.sorted();
+	for ( auto &neighbor : neighbors ) {
+		neighbor.index = this->indices_[neighbor.index];
+	}
+	return neighbors;
+}
+
+int64_t ocr::KDTree::build( arma::uword begin, arma::uword end,
+	std::vector<arma::uword> &order, const arma::mat &training_set ) {
+
+	int64_t node_index = this->nodes_.size();
+	this->nodes_.push_back(Node{begin, end, 0, 0., -1, -1});
+	if ( end - begin <= this->leaf_size_ ) {
+		return node_index;
+	}
+
+	// Split along the dimension with the largest spread
+	arma::vec lower = training_set.col(order[begin]);
+	arma::vec upper = lower;
+	for ( arma::uword i = begin+1; i < end; i++ ) {
+		lower = arma::min(lower, training_set.unsafe_col(order[i]));
+		upper = arma::max(upper, training_set.unsafe_col(order[i]));
+	}
+	arma::vec spread = upper - lower;
+	arma::uword dimension = spread.index_max();
+	if ( upper[dimension] == lower[dimension] ) {
+		return node_index;
+	}
+
+	arma::uword middle = begin + (end - begin)/2;
+	std::nth_element(order.begin() + begin, order.begin() + middle,
+		order.begin() + end, [&](arma::uword a, arma::uword b) {
+			return training_set.at(dimension, a) < training_set.at(dimension, b);
+		});
+	double split_value = training_set.at(dimension, order[middle]);
+
+	int64_t left = build(begin, middle, order, training_set);
+	int64_t right = build(middle, end, order, training_set);
+
+	Node &node = this->nodes_[node_index];
+	node.split_dimension = dimension;
+	node.split_value = split_value;
+	node.left = left;
+	node.right = right;
+
+	return node_index;
+}
+
+void ocr::KDTree::search( int64_t node_index, const arma::vec &query,
+	double cell_distance, arma::vec &offsets, ocr::NeighborHeap &heap ) {
+
+	const Node &node = this->nodes_[node_index];
+
+	if ( node.left < 0 ) {
+		for ( arma::uword i = node.begin; i < node.end; i++ ) {
+			heap.push(this->metric_.rank_distance(query, this->points_.unsafe_col(i)), i);
+		}
+		return;
+	}
+
+	// Descend into the cell containing the query first. The far cell is
+	// bounded by replacing the offset along the split dimension, which keeps
+	// the bound incremental (Arya & Mount).
+	const arma::uword dimension = node.split_dimension;
+	const double difference = query[dimension] - node.split_value;
+	const int64_t near = ( difference < 0 ) ? node.left : node.right;
+	const int64_t far = ( difference < 0 ) ? node.right : node.left;
+
+	search(near, query, cell_distance, offsets, heap);
+
+	const uint32_t p = this->metric_.get_p_value();
+	const double old_offset = offsets[dimension];
+	const double far_distance = cell_distance
+		- ocr::kernels::power(std::abs(old_offset), p)
+		+ ocr::kernels::power(std::abs(difference), p);
+
+	if ( far_distance <= heap.bound() ) {
+		offsets[dimension] = difference;
+		search(far, query, far_distance, offsets, heap);
+		offsets[dimension] = old_offset;
+	}
+}
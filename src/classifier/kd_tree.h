@@ -0,0 +1,146 @@
+#ifndef OCR_CLASSIFIER_KD_TREE_H_
+#define OCR_CLASSIFIER_KD_TREE_H_
+
+#include "classifier/classifier.h"
+
+#include <vector>
+
+#include "classifier/neighbor_heap.h"
+#include "classifier/voting.h"
+#include "metric/pnorm_metric.h"
+#include "util/ocrtypes.h"
+
+namespace ocr {
+
+/**
+ * A k-Nearest-Neighbor classifier searching a k-d tree.
+ *
+ * Builds a k-d tree over the training set when trained and answers exact
+ * nearest neighbor queries under a p-norm by descending the tree and pruning
+ * every cell that lies farther from the query than the current k-th best
+ * neighbor. The tree is most effective on low-dimensional data, such as a
+ * training set reduced by PCA.
+ */
+class KDTree : public ClassifierInterface {
+public:
+	/**
+	 * Constructor for the k-d tree classifier
+	 *
+	 * @param[in] k number of neighbors that vote on a label
+	 * @param[in] p_value p of the p-norm used as the distance
+	 * @param[in] leaf_size maximum number of training entries in a leaf
+	 */
+	KDTree( uint32_t k = 1, uint32_t p_value = 2, arma::uword leaf_size = 16 );
+	~KDTree() {}
+
+	/**
+	 * Trains the classifier given a dataset and known labels for the set
+	 *
+	 * Builds the tree by recursively splitting the entries at the median of
+	 * the dimension with the largest spread until each leaf holds at most
+	 * leaf_size entries. The training entries are stored in leaf order.
+	 *
+	 * @param[in] data_set nxm matrix with each entry in a column
+	 * @param[in] label_set mx1 vector of data_set labels
+	 */
+	void train(const arma::mat &data_set, const arma::Col<label_t> &label_set);
+	// Moved datasets are taken by the base class and trained on as above
+	using ClassifierInterface::train;
+
+	/**
+	 * Predict the label of a single vector.
+	 *
+	 * Finds the k nearest training entries and returns the label held by
+	 * most of them. Ties are broken in favor of the label of the nearest
+	 * entry among the tied labels.
+	 *
+	 * @param[in] predict_vector nx1 vector, whose label is desired
+	 *
+	 * @return classification label (defined by type label_t) of the input
+	 *   vector
+	 */
+	label_t predict( const arma::vec &predict_vector );
+
+	/**
+	 * Find the k nearest training entries of a vector
+	 *
+	 * @param[in] query nx1 vector whose neighbors are desired
+	 *
+	 * @return the k nearest neighbors ordered from nearest to farthest, with
+	 *   indices into the columns of the training set and distances given as
+	 *   the p-th power of the p-norm
+	 */
+	std::vector<Neighbor> nearest_neighbors( const arma::vec &query );
+
+protected:
+	/**
+	 * Predict the label of a single vector along with its scores
+	 *
+	 * The distance is that of the nearest neighbor holding the label, and the
+	 * confidence is the fraction of the k neighbors holding it.
+	 *
+	 * @param[in] predict_vector nx1 vector, whose label is desired
+	 * @param[out] distance distance to the nearest neighbor holding the label
+	 * @param[out] confidence fraction of the neighbors holding the label
+	 *
+	 * @return classification label (defined by type label_t) of the input
+	 *   vector
+	 */
+	label_t predict_scored( const arma::vec &predict_vector, double &distance,
+							double &confidence );
+
+private:
+	/**
+	 * A node of the tree
+	 *
+	 * Covers the training entries in [begin, end) of the reordered training
+	 * set. Leaves have no children; inner nodes split their entries on
+	 * split_dimension at split_value.
+	 */
+	struct Node {
+		arma::uword begin;
+		arma::uword end;
+		arma::uword split_dimension;
+		double split_value;
+		int64_t left;
+		int64_t right;
+	};
+
+	/**
+	 * Recursively build the subtree over a range of the index permutation
+	 *
+	 * @param[in] begin first position in the permutation
+	 * @param[in] end one past the last position in the permutation
+	 * @param[in,out] order permutation of training entry indices
+	 * @param[in] data_set nxm matrix with each entry in a column
+	 *
+	 * @return index of the subtree's root in nodes_
+	 */
+	int64_t build( arma::uword begin, arma::uword end,
+				   std::vector<arma::uword> &order, const arma::mat &data_set );
+
+	/**
+	 * Recursively search a subtree
+	 *
+	 * @param[in] node index of the subtree's root
+	 * @param[in] query nx1 query vector
+	 * @param[in] cell_distance lower bound on the distance from the query to
+	 *   any entry in the subtree
+	 * @param[in,out] offsets per-dimension offset from the query to the cell
+	 * @param[in,out] heap nearest neighbors found so far
+	 */
+	void search( int64_t node, const arma::vec &query, double cell_distance,
+				 arma::vec &offsets, NeighborHeap &heap );
+
+	uint32_t k_; /// Number of voting neighbors
+	arma::uword leaf_size_; /// Maximum entries per leaf
+	PNorm metric_; /// Distance between entries
+	std::vector<Node> nodes_; /// Tree nodes, root first
+	arma::mat points_; /// Training entries in leaf order
+	arma::Col<label_t> labels_; /// Labels of the training entries
+	arma::uvec indices_; /// Original column of each entry in leaf order
+};
+
+}
+
+#endif // OCR_CLASSIFIER_KD_TREE_H_
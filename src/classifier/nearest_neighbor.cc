@@ -1,51 +1,458 @@
 #include "classifier/nearest_neighbor.h"
 
-ocr::NearestNeighbor::NearestNeighbor( ocr::Metric *metric ) {
+namespace {
+
+/**
+ * Key identifying a saved model of the class and element type
+ */
+template<typename eT>
+uint64_t model_key() {
+	return ocr::DatasetCache::hash({}, std::string("ocr::NearestNeighbor<")
+		+ std::to_string(ocr::cache::TypeCode<eT>::value) + ">");
+}
+
+}
+
+template<typename eT>
+const arma::uword ocr::BasicNearestNeighbor<eT>::kQueryBlockSize;
+template<typename eT>
+const arma::uword ocr::BasicNearestNeighbor<eT>::kTrainingBlockSize;
+
+template<typename eT>
+ocr::BasicNearestNeighbor<eT>::BasicNearestNeighbor( ocr::BasicMetric<eT> *metric ) {
 	this->metric_ = metric;
+	this->batched_ = true;
+	this->early_abandon_ = false;
+	this->variance_order_ = false;
 }
 
-void ocr::NearestNeighbor::train( const arma::mat &training_set,
+template<typename eT>
+void ocr::BasicNearestNeighbor<eT>::train( const arma::Mat<eT> &training_set,
 	const arma::Col<ocr::label_t> &training_labels) {
 
-	this->training_set_ = training_set;
+	release();
 	this->training_labels_ = training_labels;
+	if ( !store_reordered(training_set) ) {
+		this->training_set_ = training_set;
+	}
+	prepare();
 }
 
-ocr::label_t ocr::NearestNeighbor::predict( const arma::vec &predict_vector ) {
+template<typename eT>
+void ocr::BasicNearestNeighbor<eT>::train( arma::Mat<eT> &&training_set,
+	arma::Col<ocr::label_t> &&training_labels ) {
 
-	size_t nearest_neighbor_index = -1;
+	release();
+	this->training_labels_.steal_mem(training_labels);
+	if ( !store_reordered(training_set) ) {
+		this->training_set_.steal_mem(training_set);
+	}
+	training_set.reset();
+	prepare();
+}
 
-	arma::vec distances = arma::vec(this->training_set_.n_cols);
-	for ( arma::uword i = 0; i < this->training_set_.n_cols; i++ ) {
-		distances[i] = this->metric_->distance(predict_vector, this->training_set_.unsafe_col(i));
+template<typename eT>
+void ocr::BasicNearestNeighbor<eT>::train_view( const arma::Mat<eT> &training_set,
+	const arma::Col<ocr::label_t> &training_labels ) {
+
+	release();
+
+	// Views without strict size leave the memory to the caller, and are
+	// replaced by memory of their own when assigned to
+	arma::Col<ocr::label_t> labels_view = arma::Col<ocr::label_t>(
+		const_cast<ocr::label_t*>(training_labels.memptr()),
+		training_labels.n_elem, false, false);
+	this->training_labels_.steal_mem(labels_view);
+	if ( !store_reordered(training_set) ) {
+		arma::Mat<eT> view = arma::Mat<eT>(const_cast<eT*>(training_set.memptr()),
+			training_set.n_rows, training_set.n_cols, false, false);
+		this->training_set_.steal_mem(view);
+	}
+	prepare();
+}
+
+template<typename eT>
+ocr::label_t ocr::BasicNearestNeighbor<eT>::predict(
+	const arma::Col<eT> &predict_vector ) {
+	if ( this->dimension_order_.is_empty() ) {
+		return this->training_labels_[scan(predict_vector)];
 	}
+	return this->training_labels_[scan(predict_vector.elem(this->dimension_order_))];
+}
 
-	nearest_neighbor_index = distances.index_min();
+template<typename eT>
+void ocr::BasicNearestNeighbor<eT>::test_batch( const arma::Mat<eT> &test_vectors,
+	arma::Col<ocr::label_t> &predicted_labels, arma::Col<eT> *distances,
+	arma::Col<eT> *confidence ) {
+	if ( !this->batched_ || this->early_abandon_ || this->training_norms_.is_empty() ) {
+		ocr::BasicClassifier<eT>::test_batch(test_vectors, predicted_labels,
+			distances, confidence);
+		return;
+	}
+
+	const bool scored = ( distances != nullptr || confidence != nullptr );
+	arma::uvec nearest = arma::uvec(test_vectors.n_cols);
+	arma::uvec other = arma::uvec(scored ? test_vectors.n_cols : 0);
+	if ( distances != nullptr ) {
+		distances->set_size(test_vectors.n_cols);
+	}
+	if ( confidence != nullptr ) {
+		confidence->set_size(test_vectors.n_cols);
+	}
+
+	arma::Mat<eT> reordered_vectors;
+	const arma::Mat<eT> *queries = &test_vectors;
+	if ( !this->dimension_order_.is_empty() ) {
+		reordered_vectors = test_vectors.rows(this->dimension_order_);
+		queries = &reordered_vectors;
+	}
 
-	return this->training_labels_[nearest_neighbor_index];
+	// Threads receive whole query blocks so that each matrix product keeps
+	// the same shape as in the single-threaded case
+	size_t n_blocks = (test_vectors.n_cols + kQueryBlockSize - 1)/kQueryBlockSize;
+	ocr::utilities::parallel_for(n_blocks, this->num_threads_,
+		[&](size_t first, size_t last) {
+			const arma::uword first_column = first*kQueryBlockSize;
+			const arma::uword last_column =
+				std::min<arma::uword>(last*kQueryBlockSize, test_vectors.n_cols);
+			test_batched(*queries, first_column, last_column, nearest.memptr(),
+				scored ? other.memptr() : nullptr);
+
+			for ( arma::uword i = first_column; scored && i < last_column; i++ ) {
+				eT distance, entry_confidence;
+				score(queries->unsafe_col(i), nearest[i], other[i], distance,
+					entry_confidence);
+				if ( distances != nullptr ) {
+					(*distances)[i] = distance;
+				}
+				if ( confidence != nullptr ) {
+					(*confidence)[i] = entry_confidence;
+				}
+			}
+		});
+
+	predicted_labels = this->training_labels_.elem(nearest);
+}
+
+template<typename eT>
+void ocr::BasicNearestNeighbor<eT>::set_batched(bool batched) {
+	this->batched_ = batched;
 }
 
-ocr::label_t* ocr::NearestNeighbor::test( const arma::mat &test_vectors ) {
-	ocr::label_t *predicted_labels = 
-		(ocr::label_t*)malloc(sizeof(ocr::label_t)*test_vectors.n_cols);
+template<typename eT>
+void ocr::BasicNearestNeighbor<eT>::set_early_abandon(bool early_abandon,
+	bool variance_order) {
+	this->early_abandon_ = early_abandon;
+	this->variance_order_ = variance_order;
+}
 
-	for ( size_t i = 0; i < test_vectors.n_cols; i++ ) {
-		predicted_labels[i] = predict(test_vectors.unsafe_col(i));
+template<typename eT>
+double ocr::BasicNearestNeighbor<eT>::get_touched_fraction() const {
+	uint64_t candidates = this->candidates_.get();
+	if ( candidates == 0 || this->training_set_.n_rows == 0 ) {
+		return 0.;
 	}
+	return 1.0*this->touched_.get()/candidates/this->training_set_.n_rows;
+}
 
-	return &predicted_labels[0];
+template<typename eT>
+void ocr::BasicNearestNeighbor<eT>::reset_statistics() {
+	this->candidates_.reset();
+	this->touched_.reset();
 }
 
-double ocr::NearestNeighbor::validate( const arma::mat &test_vectors,
-	const arma::Col<ocr::label_t> &real_labels,
-	arma::Col<ocr::label_t> *predicted_labels) {
+template<typename eT>
+ocr::label_t ocr::BasicNearestNeighbor<eT>::predict_scored(
+	const arma::Col<eT> &predict_vector, eT &distance, eT &confidence ) {
+	arma::Col<eT> reordered_vector;
+	const arma::Col<eT> *query = &predict_vector;
+	if ( !this->dimension_order_.is_empty() ) {
+		reordered_vector = predict_vector.elem(this->dimension_order_);
+		query = &reordered_vector;
+	}
 
-	ocr::label_t *test_labels = test(test_vectors);
-	size_t errors = 0;
+	arma::uword other;
+	const arma::uword nearest = scan(*query, &other);
+	score(*query, nearest, other, distance, confidence);
+	return this->training_labels_[nearest];
+}
 
-	for ( int i = 0; i < test_vectors.n_cols; i++ ) {
-		errors += ( test_labels[i] != real_labels[i] );
+template<typename eT>
+void ocr::BasicNearestNeighbor<eT>::release() {
+	// Detach the training set from a mapped model or from memory of the
+	// caller before the model is released
+	this->training_set_.reset();
+	this->training_labels_.reset();
+	this->model_.reset();
+}
+
+template<typename eT>
+bool ocr::BasicNearestNeighbor<eT>::store_reordered(
+	const arma::Mat<eT> &training_set ) {
+	// Distances do not depend on the order of the dimensions, so the stored
+	// entries and every query can be permuted alike
+	if ( this->early_abandon_ && this->variance_order_ && training_set.n_cols > 1 ) {
+		arma::Col<eT> variances = arma::var(training_set, 0, 1);
+		this->dimension_order_ = arma::sort_index(variances, "descend");
+		this->training_set_ = training_set.rows(this->dimension_order_);
+		return true;
 	}
 
-	return 1.0*errors/test_vectors.n_cols;
+	this->dimension_order_.reset();
+	return false;
 }
+
+template<typename eT>
+void ocr::BasicNearestNeighbor<eT>::prepare() {
+	reset_statistics();
+
+	if ( is_euclidean() ) {
+		this->training_norms_ = arma::sum(arma::square(this->training_set_), 0);
+	}
+	else {
+		this->training_norms_.reset();
+	}
+}
+
+template<typename eT>
+bool ocr::BasicNearestNeighbor<eT>::is_euclidean() const {
+	const ocr::BasicPNorm<eT> *pnorm =
+		dynamic_cast<const ocr::BasicPNorm<eT>*>(this->metric_);
+	return pnorm != nullptr && pnorm->get_p_value() == 2;
+}
+
+template<typename eT>
+arma::uword ocr::BasicNearestNeighbor<eT>::scan(
+	const arma::Col<eT> &predict_vector, arma::uword *other ) {
+	arma::uword nearest_neighbor_index = 0;
+	eT nearest_distance = std::numeric_limits<eT>::max();
+
+	ocr::BasicPNorm<eT> *pnorm = dynamic_cast<ocr::BasicPNorm<eT>*>(this->metric_);
+	if ( this->early_abandon_ && pnorm != nullptr && other == nullptr ) {
+		uint64_t touched = 0;
+		for ( arma::uword i = 0; i < this->training_set_.n_cols; i++ ) {
+			size_t dimensions = 0;
+			eT distance = pnorm->partial_rank_distance(predict_vector,
+				this->training_set_.unsafe_col(i), nearest_distance, dimensions);
+			touched += dimensions;
+			if ( distance < nearest_distance ) {
+				nearest_distance = distance;
+				nearest_neighbor_index = i;
+			}
+		}
+
+		this->candidates_.add(this->training_set_.n_cols);
+		this->touched_.add(touched);
+		return nearest_neighbor_index;
+	}
+
+	// Track the running nearest entry rather than storing every distance.
+	// The nearest entry of another label only changes when the nearest entry
+	// does, in which case the former nearest entry takes its place, or when
+	// a farther entry of another label is nearer than it.
+	const arma::Col<ocr::label_t> &labels = this->training_labels_;
+	arma::uword other_index = this->training_set_.n_cols;
+	eT other_distance = std::numeric_limits<eT>::max();
+	for ( arma::uword i = 0; i < this->training_set_.n_cols; i++ ) {
+		eT distance = this->metric_->rank_distance(predict_vector,
+			this->training_set_.unsafe_col(i));
+		if ( distance < nearest_distance ) {
+			if ( other != nullptr && labels[i] != labels[nearest_neighbor_index] ) {
+				other_distance = nearest_distance;
+				other_index = nearest_neighbor_index;
+			}
+			nearest_distance = distance;
+			nearest_neighbor_index = i;
+		}
+		else if ( other != nullptr && distance < other_distance
+			&& labels[i] != labels[nearest_neighbor_index] ) {
+			other_distance = distance;
+			other_index = i;
+		}
+	}
+
+	if ( other != nullptr ) {
+		*other = other_index;
+	}
+	return nearest_neighbor_index;
+}
+
+template<typename eT>
+void ocr::BasicNearestNeighbor<eT>::test_batched( const arma::Mat<eT> &test_vectors,
+	arma::uword first, arma::uword last, arma::uword *nearest, arma::uword *other ) {
+
+	const arma::uword n_rows = this->training_set_.n_rows;
+	const arma::uword n_train = this->training_set_.n_cols;
+
+	arma::Mat<eT> cross_products;
+	arma::Col<eT> best_distances = arma::Col<eT>(kQueryBlockSize);
+	arma::uvec best_indices = arma::uvec(kQueryBlockSize);
+	arma::Col<eT> other_distances = arma::Col<eT>(kQueryBlockSize);
+	arma::uvec other_indices = arma::uvec(kQueryBlockSize);
+	const arma::Col<ocr::label_t> &labels = this->training_labels_;
+
+	for ( arma::uword q = first; q < last; q += kQueryBlockSize ) {
+		const arma::uword n_queries = std::min(kQueryBlockSize, last - q);
+		const arma::Mat<eT> query_block = arma::Mat<eT>(
+			const_cast<eT*>(test_vectors.colptr(q)), n_rows, n_queries,
+			false, true);
+
+		best_distances.fill(std::numeric_limits<eT>::max());
+		best_indices.zeros();
+		other_distances.fill(std::numeric_limits<eT>::max());
+		other_indices.fill(n_train);
+
+		for ( arma::uword t = 0; t < n_train; t += kTrainingBlockSize ) {
+			const arma::uword n_block = std::min(kTrainingBlockSize, n_train - t);
+			const arma::Mat<eT> training_block = arma::Mat<eT>(
+				const_cast<eT*>(this->training_set_.colptr(t)), n_rows,
+				n_block, false, true);
+
+			// The squared norm of the query is identical for every training
+			// entry, so it is left out of the comparison entirely
+			cross_products = training_block.t() * query_block;
+
+			const eT *norms = this->training_norms_.memptr() + t;
+			for ( arma::uword j = 0; j < n_queries; j++ ) {
+				const eT *cross = cross_products.colptr(j);
+				if ( other == nullptr ) {
+					for ( arma::uword i = 0; i < n_block; i++ ) {
+						eT distance = norms[i] - 2*cross[i];
+						if ( distance < best_distances[j] ) {
+							best_distances[j] = distance;
+							best_indices[j] = t + i;
+						}
+					}
+					continue;
+				}
+
+				// As in scan, tracking the nearest entry of another label
+				for ( arma::uword i = 0; i < n_block; i++ ) {
+					eT distance = norms[i] - 2*cross[i];
+					if ( distance < best_distances[j] ) {
+						if ( labels[t+i] != labels[best_indices[j]] ) {
+							other_distances[j] = best_distances[j];
+							other_indices[j] = best_indices[j];
+						}
+						best_distances[j] = distance;
+						best_indices[j] = t + i;
+					}
+					else if ( distance < other_distances[j]
+						&& labels[t+i] != labels[best_indices[j]] ) {
+						other_distances[j] = distance;
+						other_indices[j] = t + i;
+					}
+				}
+			}
+		}
+
+		for ( arma::uword j = 0; j < n_queries; j++ ) {
+			nearest[q+j] = best_indices[j];
+			if ( other != nullptr ) {
+				other[q+j] = other_indices[j];
+			}
+		}
+	}
+}
+
+template<typename eT>
+void ocr::BasicNearestNeighbor<eT>::score( const arma::Col<eT> &query,
+	arma::uword nearest, arma::uword other, eT &distance, eT &confidence ) {
+	distance = this->metric_->distance(query, this->training_set_.unsafe_col(nearest));
+	if ( other >= this->training_set_.n_cols ) {
+		confidence = 1;
+		return;
+	}
+
+	const eT other_distance =
+		this->metric_->distance(query, this->training_set_.unsafe_col(other));
+	confidence = ( distance + other_distance > 0 )
+		? other_distance/(distance + other_distance) : eT(0.5);
+}
+
+template<typename eT>
+bool ocr::BasicNearestNeighbor<eT>::save( std::ostream &ostream ) const {
+	const ocr::BasicPNorm<eT> *pnorm =
+		dynamic_cast<const ocr::BasicPNorm<eT>*>(this->metric_);
+	const arma::vec parameters = {
+		pnorm != nullptr ? double(pnorm->get_p_value()) : 0.,
+		double(this->batched_), double(this->early_abandon_),
+		double(this->variance_order_)};
+	const arma::Col<uint32_t> dimension_order =
+		arma::conv_to<arma::Col<uint32_t>>::from(this->dimension_order_);
+
+	ocr::DatasetCacheWriter writer;
+	writer.add("parameters", parameters);
+	writer.add("training_set", this->training_set_);
+	writer.add("training_labels", this->training_labels_);
+	writer.add("training_norms", this->training_norms_);
+	writer.add("dimension_order", dimension_order);
+	return writer.write(ostream, model_key<eT>());
+}
+
+template<typename eT>
+bool ocr::BasicNearestNeighbor<eT>::load( std::istream &istream ) {
+	return restore(std::make_shared<ocr::DatasetCache>(istream), false);
+}
+
+template<typename eT>
+bool ocr::BasicNearestNeighbor<eT>::load_file( const std::string &filename ) {
+	return restore(std::make_shared<ocr::DatasetCache>(filename), true);
+}
+
+template<typename eT>
+bool ocr::BasicNearestNeighbor<eT>::restore(
+	const std::shared_ptr<ocr::DatasetCache> &model, bool mapped ) {
+	if ( !model->is_open()
+		|| model->get_key() != model_key<eT>()
+		|| !model->verify() ) {
+		return false;
+	}
+
+	const arma::vec parameters = model->get<double>("parameters");
+	const arma::Mat<eT> training_set = model->get<eT>("training_set");
+	const arma::Mat<label_t> training_labels = model->get<label_t>("training_labels");
+	const arma::Mat<eT> training_norms = model->get<eT>("training_norms");
+	const arma::Mat<uint32_t> dimension_order = model->get<uint32_t>("dimension_order");
+	if ( parameters.n_elem != 4 || training_labels.n_elem != training_set.n_cols
+		|| ( training_norms.n_elem != 0
+			&& training_norms.n_elem != training_set.n_cols )
+		|| ( dimension_order.n_elem != 0
+			&& dimension_order.n_elem != training_set.n_rows ) ) {
+		return false;
+	}
+
+	// The metric belongs to the caller, so a model measured with another
+	// p-norm is rejected rather than the metric replaced
+	const uint32_t p_value = parameters[0];
+	const ocr::BasicPNorm<eT> *pnorm =
+		dynamic_cast<const ocr::BasicPNorm<eT>*>(this->metric_);
+	if ( p_value > 0 && ( pnorm == nullptr || pnorm->get_p_value() != p_value ) ) {
+		return false;
+	}
+
+	this->batched_ = parameters[1] != 0;
+	this->early_abandon_ = parameters[2] != 0;
+	this->variance_order_ = parameters[3] != 0;
+
+	release();
+	if ( mapped ) {
+		// Use the training set in place; the view does not own its memory,
+		// so the mapping is kept open alongside it
+		arma::Mat<eT> view = arma::Mat<eT>(const_cast<eT*>(training_set.memptr()),
+			training_set.n_rows, training_set.n_cols, false, false);
+		this->training_set_.steal_mem(view);
+		this->model_ = model;
+	}
+	else {
+		this->training_set_ = training_set;
+	}
+	this->training_labels_ = training_labels;
+	this->training_norms_ = training_norms;
+	this->dimension_order_ = arma::conv_to<arma::uvec>::from(dimension_order);
+	reset_statistics();
+	return true;
+}
+
+template class ocr::BasicNearestNeighbor<double>;
+template class ocr::BasicNearestNeighbor<float>;
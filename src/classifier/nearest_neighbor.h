@@ -6,9 +6,15 @@
 #include <float.h>
 #include <string.h>
 
+#include <algorithm>
+#include <limits>
+#include <memory>
+
 #include "metric/metric.h"
 #include "metric/pnorm_metric.h"
+#include "parser/dataset_cache.h"
 #include "util/ocrtypes.h"
+#include "util/serialize.h"
 
 namespace ocr {
 
@@ -16,8 +22,14 @@ namespace ocr {
  * A simple Nearest-Neighbor algorithm implementation.
  *
  * Defines the methodology for implementing a Nearest-Neighbor algorithm.
+ * NearestNeighbor stores and compares doubles and FNearestNeighbor floats,
+ * which halves the memory traffic of the scan and of the batched products.
+ *
+ * A trained classifier can be saved and restored. Restoring it from a file
+ * maps the file, and the training set is used in place from the mapping.
  */
-class NearestNeighbor : public ClassifierInterface {
+template<typename eT>
+class BasicNearestNeighbor : public BasicClassifier<eT>, public Serializable {
 public:
 	friend class NearestNeighborTests;
 
@@ -29,8 +41,8 @@ public:
 	 *
 	 * @param[in] metric A metric specified by the Metric class
 	 */
-	NearestNeighbor( Metric *metric = new PNorm() );
-	~NearestNeighbor() {}
+	BasicNearestNeighbor( BasicMetric<eT> *metric = new BasicPNorm<eT>() );
+	~BasicNearestNeighbor() {}
 
 	/**
 	 * Trains the classifier given a dataset and known labels for the set
@@ -42,7 +54,33 @@ public:
 	 * @param[in] data_set nxm matrix with each entry in a column
 	 * @param[in] label_set mx1 vector of data_set labels
 	 */
-	void train(const arma::mat &data_set, const arma::Col<label_t> &label_set);
+	void train(const arma::Mat<eT> &data_set, const arma::Col<label_t> &label_set);
+
+	/**
+	 * Trains the classifier given a dataset and labels moved into it
+	 *
+	 * Takes over the memory of the dataset and labels instead of copying
+	 * them, and leaves both arguments empty. When the dimensions are stored
+	 * in variance order, the dataset is copied in that order and released.
+	 *
+	 * @param[in] data_set nxm matrix with each entry in a column
+	 * @param[in] label_set mx1 vector of data_set labels
+	 */
+	void train(arma::Mat<eT> &&data_set, arma::Col<label_t> &&label_set);
+
+	/**
+	 * Trains the classifier on a dataset and labels it does not own
+	 *
+	 * The classifier reads the dataset and labels in place, so they must
+	 * outlive the classifier, or its next train or load, and must not be
+	 * modified in the meantime. When the dimensions are stored in variance
+	 * order, the dataset is copied in that order.
+	 *
+	 * @param[in] data_set nxm matrix with each entry in a column
+	 * @param[in] label_set mx1 vector of data_set labels
+	 */
+	void train_view(const arma::Mat<eT> &data_set,
+					const arma::Col<label_t> &label_set);
 
 	/**
 	 * Predict the label of a single vector.
@@ -56,47 +94,242 @@ public:
 	 * @return classification label (defined by type label_t) of the input
 	 *   vector
 	 */
-	label_t predict( const arma::vec &predict_vector );
+	label_t predict( const arma::Col<eT> &predict_vector );
 
 	/**
-	 * Predict the labels of several vectors.
+	 * Predict the labels of several vectors, with optional scores.
 	 *
 	 * Uses the trained algorithm to determine the label of each n-dimensional
 	 * column vector in a nxm matrix of entries where each entry is stored in
 	 * a column. This method assumes that the training method has already been
-	 * completed.
+	 * completed. The columns are split across the threads set by
+	 * set_num_threads.
+	 *
+	 * The distance of an entry is its distance to the nearest training
+	 * entry. Its confidence compares that distance d with the distance d' to
+	 * the nearest training entry of any other label, as d'/(d + d'): 1 when
+	 * the other labels are far away, 1/2 when one is as near as the
+	 * predicted label, and 1 when the training set has a single label.
 	 *
 	 * @param[in] test_mat nxm matrix with each entry in a column
+	 * @param[out] labels mx1 vector of classification labels
+	 * @param[out] distances optional mx1 vector of nearest distances
+	 * @param[out] confidence optional mx1 vector of label confidences
+	 */
+	void test_batch( const arma::Mat<eT> &test_mat, arma::Col<label_t> &labels,
+					 arma::Col<eT> *distances = nullptr,
+					 arma::Col<eT> *confidence = nullptr );
+
+	/**
+	 * Enable or disable the batched Euclidean distance computation
+	 *
+	 * When the metric is the Euclidean p-norm, test computes whole blocks of
+	 * query-to-training distances at once through the expansion
+	 * \f$ \|x-y\|^2 = \|x\|^2 + \|y\|^2 - 2x^Ty \f$, so that the bulk of
+	 * the work is a single matrix product. The squared norms of the training
+	 * entries are cached by train. Enabled by default and ignored for every
+	 * other metric.
 	 *
-	 * @return column vector of classification labels (defined by type label_t)
-	 *   where each i-th entry corresponds to the i-th column of the input
+	 * @param[in] batched whether to use the batched computation
 	 */
-	label_t* test( const arma::mat &test_mat );
+	void set_batched(bool batched);
 
 	/**
-	 * Determine the error rate for a given test set
+	 * Enable or disable early abandoning of candidates during the scan
 	 *
-	 * Computes the labels for a given dataset and compares to given known
-	 * labels. The resulting comparison is used to determine the overall
-	 * error rate of the algorithm for that dataset. This method assumes that
-	 * the training method has already been completed.
+	 * When the metric is a p-norm, the distance to each candidate is
+	 * accumulated block by block and the candidate is dropped as soon as the
+	 * partial sum exceeds the distance to the nearest entry found so far.
+	 * Summing the dimensions of largest variance first rejects candidates
+	 * sooner; the variance order is computed from the training set and takes
+	 * effect on the next call to train. When enabled, test scans the entries
+	 * instead of using the batched Euclidean computation.
 	 *
-	 * @param[in] test_mat nxm matrix with each entry in a column
-	 * @param[in] true_labels mx1 column vector of true labels
-	 * @param[out] predicted_labels mx1 column vector of predicted labels
+	 * @param[in] early_abandon whether to abandon candidates early
+	 * @param[in] variance_order whether to visit dimensions in decreasing
+	 *   order of training set variance
+	 */
+	void set_early_abandon(bool early_abandon, bool variance_order = false);
+
+	/**
+	 * Returns the mean fraction of dimensions accumulated per candidate
+	 *
+	 * Averages over every candidate scanned with early abandoning since the
+	 * last train or reset_statistics. A full scan touches every dimension.
+	 *
+	 * @return fraction of dimensions touched per candidate in [0, 1]
+	 */
+	double get_touched_fraction() const;
+
+	/**
+	 * Resets the early abandoning statistics
+	 */
+	void reset_statistics();
+
+	/**
+	 * Save the trained classifier to a stream
+	 *
+	 * Writes the training set, its labels and norms, the dimension order and
+	 * the options of the classifier. The metric is saved as its p if it is
+	 * a p-norm, and the classifier that is loaded must then use a p-norm of
+	 * the same p; any other metric is left to the classifier that is loaded.
+	 *
+	 * @param[in] ostream binary output stream
+	 *
+	 * @return true if the stream is still good after writing
+	 */
+	bool save( std::ostream &ostream ) const;
+
+	/**
+	 * Restore a trained classifier from a stream
+	 *
+	 * @param[in] istream binary stream written by save
+	 *
+	 * @return true if the classifier was restored, false (leaving it
+	 *   unchanged) if the data is corrupt, not a classifier of this type or
+	 *   measured with another p-norm
+	 */
+	bool load( std::istream &istream );
+
+	/**
+	 * Restore a trained classifier by mapping a file written by save
+	 *
+	 * The training set is not copied: it is used in place from the mapping,
+	 * which stays open until the classifier is trained again or destroyed.
+	 *
+	 * @param[in] filename name of the file to map
+	 *
+	 * @return true if the classifier was restored
+	 */
+	bool load_file( const std::string &filename );
+
+protected:
+	/**
+	 * Predict the label of a single vector along with its scores
+	 *
+	 * The scores are those described for test_batch.
 	 *
-	 * @return fractional error rate
+	 * @param[in] predict_vector nx1 vector, whose label is desired
+	 * @param[out] distance distance to the nearest training entry
+	 * @param[out] confidence confidence in [0, 1] of the returned label
+	 *
+	 * @return classification label (defined by type label_t) of the input
+	 *   vector
 	 */
-	double validate( const arma::mat &test_mat,
-					 const arma::Col<label_t> &true_labels,
-					 arma::Col<label_t> *predicted_labels = nullptr	);
+	label_t predict_scored( const arma::Col<eT> &predict_vector, eT &distance,
+							eT &confidence );
 
 private:
-	arma::mat training_set_;
+	/**
+	 * Returns true if the metric is the Euclidean p-norm
+	 */
+	bool is_euclidean() const;
+
+	/**
+	 * Release the training set and labels, including views of external memory
+	 *
+	 * Views are detached without writing to the memory they view, so that
+	 * the next assignment allocates memory of its own.
+	 */
+	void release();
+
+	/**
+	 * Store the training set in variance order, if enabled
+	 *
+	 * @param[in] data_set nxm matrix with each entry in a column
+	 *
+	 * @return true if the reordered training set was stored, false if the
+	 *   training set is to be stored in its own order
+	 */
+	bool store_reordered(const arma::Mat<eT> &data_set);
+
+	/**
+	 * Prepare the stored training set for queries
+	 *
+	 * Resets the statistics and caches the squared norms of the entries.
+	 */
+	void prepare();
+
+	/**
+	 * Scan the training set for the nearest entry of a vector
+	 *
+	 * When the nearest entry of another label is requested, every candidate
+	 * is compared in full, without early abandoning.
+	 *
+	 * @param[in] predict_vector nx1 vector in the dimension order of the
+	 *   stored training set
+	 * @param[out] other optional index of the nearest entry whose label
+	 *   differs from that of the nearest entry (the number of entries if
+	 *   there is none)
+	 *
+	 * @return index of the nearest training entry
+	 */
+	arma::uword scan( const arma::Col<eT> &predict_vector,
+					  arma::uword *other = nullptr );
+
+	/**
+	 * Predict the labels of a range of vectors using blocked matrix products
+	 *
+	 * Tiles the queries and the training set into blocks and computes the
+	 * inner products of each pair of blocks with a single matrix product.
+	 * Only the index of the nearest neighbor of each query is kept, along
+	 * with that of the nearest neighbor of another label when requested, so
+	 * the full distance matrix is never stored.
+	 *
+	 * @param[in] test_mat nxm matrix with each entry in a column
+	 * @param[in] first index of the first column to predict
+	 * @param[in] last index one past the last column to predict
+	 * @param[out] nearest array of m indices of the nearest entries to fill
+	 * @param[out] other optional array of m indices of the nearest entries
+	 *   of another label, as returned by scan
+	 */
+	void test_batched( const arma::Mat<eT> &test_mat, arma::uword first,
+					   arma::uword last, arma::uword *nearest,
+					   arma::uword *other = nullptr );
+
+	/**
+	 * Compute the scores of a query from its nearest entries
+	 *
+	 * @param[in] query nx1 vector in the dimension order of the stored
+	 *   training set
+	 * @param[in] nearest index of the nearest training entry
+	 * @param[in] other index of the nearest entry of another label
+	 * @param[out] distance distance to the nearest training entry
+	 * @param[out] confidence confidence in [0, 1] of the nearest label
+	 */
+	void score( const arma::Col<eT> &query, arma::uword nearest,
+				arma::uword other, eT &distance, eT &confidence );
+
+	/**
+	 * Restore the classifier from a saved model
+	 *
+	 * @param[in] model cache holding the saved model
+	 * @param[in] mapped whether to use the training set in place
+	 *
+	 * @return true if the classifier was restored
+	 */
+	bool restore( const std::shared_ptr<DatasetCache> &model, bool mapped );
+
+	static const arma::uword kQueryBlockSize = 64; /// Queries per block
+	static const arma::uword kTrainingBlockSize = 4096; /// Entries per block
+
+	arma::Mat<eT> training_set_;
 	arma::Col<label_t> training_labels_;
-	Metric *metric_;
+	arma::Row<eT> training_norms_; /// Squared norms of the training entries
+	arma::uvec dimension_order_; /// Stored order of the dimensions, if any
+	BasicMetric<eT> *metric_;
+	std::shared_ptr<DatasetCache> model_; /// Mapped model viewed by training_set_
+	bool batched_;
+	bool early_abandon_; /// Abandon candidates during the scan
+	bool variance_order_; /// Order dimensions by variance at train
+
+	utilities::AtomicCounter candidates_; /// Candidates scanned
+	utilities::AtomicCounter touched_; /// Dimensions accumulated
 };
 
+typedef BasicNearestNeighbor<double> NearestNeighbor;
+typedef BasicNearestNeighbor<float> FNearestNeighbor;
+
 }
 
 #endif // OCR_CLASSIFIER_NEAREST_NEIGHBOR_H_
\ No newline at end of file
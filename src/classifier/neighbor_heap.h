@@ -0,0 +1,115 @@
+#ifndef OCR_CLASSIFIER_NEIGHBOR_HEAP_H_
+#define OCR_CLASSIFIER_NEIGHBOR_HEAP_H_
+
+#include <float.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <armadillo>
+
+namespace ocr {
+
+/**
+ * A candidate neighbor found during a search
+ *
+ * Pairs the index of a training entry with its distance to the query. The
+ * distance may be any monotone function of the metric (e.g. the value of
+ * Metric::rank_distance).
+ */
+struct Neighbor {
+	double distance;
+	arma::uword index;
+
+	/**
+	 * Orders neighbors by distance, breaking ties by the lower index
+	 */
+	bool operator<(const Neighbor &other) const {
+		return distance < other.distance
+			|| ( distance == other.distance && index < other.index );
+	}
+};
+
+/**
+ * A bounded max-heap keeping the k nearest neighbors seen so far
+ *
+ * Candidates are pushed one at a time while scanning; the heap retains only
+ * the k best, so a search never needs to store the distances to every
+ * training entry. The current k-th best distance is available in constant
+ * time and serves as the pruning bound of a search.
+ */
+class NeighborHeap {
+public:
+	/**
+	 * Constructor for the neighbor heap
+	 *
+	 * @param[in] k maximum number of neighbors retained (at least 1)
+	 */
+	explicit NeighborHeap( size_t k = 1 ) : k_(std::max<size_t>(k, 1)) {
+		this->heap_.reserve(this->k_);
+	}
+
+	/**
+	 * Removes every neighbor from the heap
+	 */
+	void clear() {
+		this->heap_.clear();
+	}
+
+	/**
+	 * Offer a candidate to the heap
+	 *
+	 * @param[in] distance distance of the candidate to the query
+	 * @param[in] index index of the candidate in the training set
+	 *
+	 * @return true if the candidate was retained
+	 */
+	bool push( double distance, arma::uword index ) {
+		Neighbor neighbor = {distance, index};
+		if ( this->heap_.size() < this->k_ ) {
+			this->heap_.push_back(neighbor);
+			std::push_heap(this->heap_.begin(), this->heap_.end());
+			return true;
+		}
+		if ( !(neighbor < this->heap_.front()) ) {
+			return false;
+		}
+		std::pop_heap(this->heap_.begin(), this->heap_.end());
+		this->heap_.back() = neighbor;
+		std::push_heap(this->heap_.begin(), this->heap_.end());
+		return true;
+	}
+
+	/**
+	 * Returns the distance a candidate must beat to be retained
+	 *
+	 * @return k-th best distance, or DBL_MAX while fewer than k are held
+	 */
+	double bound() const {
+		return this->heap_.size() < this->k_ ? DBL_MAX : this->heap_.front().distance;
+	}
+
+	/**
+	 * Returns the number of neighbors held
+	 */
+	size_t size() const {
+		return this->heap_.size();
+	}
+
+	/**
+	 * Returns the retained neighbors ordered from nearest to farthest
+	 */
+	std::vector<Neighbor> sorted() const {
+		std::vector<Neighbor> neighbors = this->heap_;
+		std::sort(neighbors.begin(), neighbors.end());
+		return neighbors;
+	}
+
+private:
+	size_t k_; /// Maximum number of neighbors
+	std::vector<Neighbor> heap_; /// Max-heap on distance
+};
+
+}
+
+#endif // OCR_CLASSIFIER_NEIGHBOR_HEAP_H_
@@ -0,0 +1,113 @@
+#include "classifier/pipeline.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+template<typename eT>
+const arma::uword ocr::BasicPipeline<eT>::kBlockSize;
+
+namespace {
+
+/**
+ * Sets the thread count of a classifier for the lifetime of the guard
+ *
+ * The previous count is restored on destruction, so the classifier is left
+ * as it was even if a prediction throws.
+ */
+template<typename eT>
+class ThreadCountGuard {
+public:
+	ThreadCountGuard( ocr::BasicClassifier<eT> *classifier, size_t num_threads )
+		: classifier_(classifier), num_threads_(classifier->get_num_threads()) {
+		this->classifier_->set_num_threads(num_threads);
+	}
+	~ThreadCountGuard() {
+		this->classifier_->set_num_threads(this->num_threads_);
+	}
+
+private:
+	ThreadCountGuard( const ThreadCountGuard& ) = delete;
+	ThreadCountGuard& operator=( const ThreadCountGuard& ) = delete;
+
+	ocr::BasicClassifier<eT> *classifier_;
+	size_t num_threads_; /// Thread count restored on destruction
+};
+
+}
+
+template<typename eT>
+ocr::BasicPipeline<eT>::BasicPipeline( ocr::BasicPCA<eT> *pca,
+	ocr::BasicClassifier<eT> *classifier ) {
+	if ( pca == nullptr || classifier == nullptr ) {
+		throw std::invalid_argument("pipeline requires a PCA and a classifier");
+	}
+	this->pca_ = pca;
+	this->classifier_ = classifier;
+}
+
+template<typename eT>
+void ocr::BasicPipeline<eT>::train(const arma::Mat<eT> &data_set,
+	const arma::Col<ocr::label_t> &label_set) {
+	// The projection is a temporary, so the classifier may keep its memory
+	this->classifier_->train(this->pca_->project(data_set),
+		arma::Col<ocr::label_t>(label_set));
+}
+
+template<typename eT>
+ocr::label_t ocr::BasicPipeline<eT>::predict(const arma::Col<eT> &predict_vector) {
+	return this->classifier_->predict(
+		arma::Col<eT>(this->pca_->project(predict_vector)));
+}
+
+template<typename eT>
+void ocr::BasicPipeline<eT>::test_batch( const arma::Mat<eT> &test_mat,
+	arma::Col<ocr::label_t> &predicted_labels, arma::Col<eT> *distances,
+	arma::Col<eT> *confidence ) {
+	predicted_labels.set_size(test_mat.n_cols);
+	if ( distances != nullptr ) {
+		distances->set_size(test_mat.n_cols);
+	}
+	if ( confidence != nullptr ) {
+		confidence->set_size(test_mat.n_cols);
+	}
+
+	const size_t num_blocks = ( test_mat.n_cols + kBlockSize - 1 ) / kBlockSize;
+	const size_t num_threads = std::min(
+		ocr::utilities::resolve_threads(this->num_threads_), num_blocks);
+	// The blocks are already spread over the threads, so each is classified
+	// on the thread it runs on
+	const ThreadCountGuard<eT> guard(this->classifier_,
+		( num_threads > 1 ) ? 1 : this->classifier_->get_num_threads());
+
+	ocr::utilities::parallel_for(num_blocks, num_threads,
+		[&](size_t first_block, size_t last_block) {
+			arma::Col<ocr::label_t> block_labels;
+			arma::Col<eT> block_distances;
+			arma::Col<eT> block_confidence;
+			for ( size_t b = first_block; b < last_block; b++ ) {
+				const arma::uword first = b*kBlockSize;
+				const arma::uword count =
+					std::min<arma::uword>(kBlockSize, test_mat.n_cols - first);
+
+				// View the block in place; only its projection is allocated
+				const arma::Mat<eT> block = arma::Mat<eT>(
+					const_cast<eT*>(test_mat.colptr(first)), test_mat.n_rows,
+					count, false, true);
+				this->classifier_->test_batch(this->pca_->project(block),
+					block_labels,
+					( distances != nullptr ) ? &block_distances : nullptr,
+					( confidence != nullptr ) ? &block_confidence : nullptr);
+
+				predicted_labels.subvec(first, first + count - 1) = block_labels;
+				if ( distances != nullptr ) {
+					distances->subvec(first, first + count - 1) = block_distances;
+				}
+				if ( confidence != nullptr ) {
+					confidence->subvec(first, first + count - 1) = block_confidence;
+				}
+			}
+		});
+}
+
+template class ocr::BasicPipeline<double>;
+template class ocr::BasicPipeline<float>;
@@ -0,0 +1,90 @@
+#ifndef OCR_CLASSIFIER_PIPELINE_H_
+#define OCR_CLASSIFIER_PIPELINE_H_
+
+#include "classifier/classifier.h"
+
+#include "util/ocrtypes.h"
+#include "util/principle_component_analysis.h"
+
+namespace ocr {
+
+/**
+ * A classifier of raw entries that chains a PCA projection with a classifier.
+ *
+ * Takes entries in the original (unprojected) space, such as raw 784-pixel
+ * images, and classifies them with a classifier trained in the reduced space
+ * of a PCA. Queries are projected in blocks of kBlockSize columns, small
+ * enough for the projected block to stay in cache, and each block is passed
+ * straight to the classifier, so the projected test set is never stored as
+ * a whole. Neither the PCA nor the classifier is owned by the pipeline.
+ * Pipeline chains components of doubles and FPipeline of floats.
+ */
+template<typename eT>
+class BasicPipeline : public BasicClassifier<eT> {
+public:
+	static const arma::uword kBlockSize = 256; /// Queries projected at a time
+
+	/**
+	 * Constructor for the pipeline
+	 *
+	 * @param[in] pca solved PCA (or one whose projection has been set)
+	 * @param[in] classifier classifier of entries in the reduced space
+	 */
+	BasicPipeline( BasicPCA<eT> *pca, BasicClassifier<eT> *classifier );
+	~BasicPipeline() {}
+
+	/**
+	 * Trains the classifier given a dataset and known labels for the set
+	 *
+	 * Projects the dataset with the PCA, which must already be solved, and
+	 * trains the classifier on the projection.
+	 *
+	 * @param[in] data_set nxm matrix with each entry in a column
+	 * @param[in] label_set mx1 vector of data_set labels
+	 */
+	void train(const arma::Mat<eT> &data_set, const arma::Col<label_t> &label_set);
+	// Moved datasets are taken by the base class and trained on as above
+	using BasicClassifier<eT>::train;
+
+	/**
+	 * Predict the label of a single vector.
+	 *
+	 * @param[in] predict_vector nx1 vector in the original space
+	 *
+	 * @return classification label (defined by type label_t) of the input
+	 *   vector
+	 */
+	label_t predict(const arma::Col<eT> &predict_vector);
+
+	/**
+	 * Predict the labels of several vectors, with optional scores.
+	 *
+	 * Projects the queries one block at a time and classifies each block
+	 * with the test_batch method of the classifier, which also computes the
+	 * requested scores in the reduced space. With several threads, each
+	 * thread projects and classifies its own blocks, and the classifier is
+	 * run with a single thread on each.
+	 *
+	 * @param[in] test_mat nxm matrix with each entry in a column, in the
+	 *   original space
+	 * @param[out] labels mx1 vector of classification labels
+	 * @param[out] distances optional mx1 vector of distances reported by the
+	 *   classifier
+	 * @param[out] confidence optional mx1 vector of label confidences
+	 *   reported by the classifier
+	 */
+	void test_batch( const arma::Mat<eT> &test_mat, arma::Col<label_t> &labels,
+					 arma::Col<eT> *distances = nullptr,
+					 arma::Col<eT> *confidence = nullptr );
+
+private:
+	BasicPCA<eT> *pca_; /// Projection into the reduced space
+	BasicClassifier<eT> *classifier_; /// Classifier of reduced entries
+};
+
+typedef BasicPipeline<double> Pipeline;
+typedef BasicPipeline<float> FPipeline;
+
+}
+
+#endif // OCR_CLASSIFIER_PIPELINE_H_
@@ -0,0 +1,53 @@
+#include "classifier/pq_nearest_neighbor.h"
+
+ocr::PQNearestNeighbor::PQNearestNeighbor( uint32_t num_subspaces,
+	uint32_t rerank, uint32_t num_centroids )
+	: quantizer_(num_subspaces, num_centroids) {
+	this->rerank_ = rerank;
+}
+
+void ocr::PQNearestNeighbor::train( const arma::mat &training_set,
+	const arma::Col<ocr::label_t> &training_labels ) {
+
+	this->quantizer_.train(training_set);
+	this->codes_ = this->quantizer_.encode(training_set);
+	this->training_labels_ = training_labels;
+
+	if ( this->rerank_ > 0 ) {
+		this->training_set_ = training_set;
+	}
+	else {
+		this->training_set_.reset();
+	}
+}
+
+ocr::label_t ocr::PQNearestNeighbor::predict( const arma::vec &predict_vector ) {
+	arma::mat table;
+	this->quantizer_.distance_table(predict_vector, table);
+
+	const arma::uword code_size = this->codes_.n_rows;
+	const uint8_t *codes = this->codes_.memptr();
+	ocr::NeighborHeap candidates = ocr::NeighborHeap(std::max<uint32_t>(this->rerank_, 1));
+	for ( arma::uword i = 0; i < this->codes_.n_cols; i++ ) {
+		candidates.push(this->quantizer_.asymmetric_distance(table,
+			codes + i*code_size), i);
+	}
+
+	if ( this->rerank_ == 0 ) {
+		return this->training_labels_[candidates.sorted()[0].index];
+	}
+
+	ocr::NeighborHeap nearest = ocr::NeighborHeap(1);
+	for ( const ocr::Neighbor &candidate : candidates.sorted() ) {
+		nearest.push(ocr::kernels::PNormKernel<double, 2>::rank(
+			predict_vector.memptr(), this->training_set_.colptr(candidate.index),
+			predict_vector.n_elem, 2), candidate.index);
+	}
+
+	return this->training_labels_[nearest.sorted()[0].index];
+}
+
+size_t ocr::PQNearestNeighbor::get_memory_bytes() const {
+	return this->codes_.n_elem*sizeof(uint8_t)
+		+ this->training_set_.n_elem*sizeof(double);
+}
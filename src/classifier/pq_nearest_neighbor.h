@@ -0,0 +1,83 @@
+#ifndef OCR_CLASSIFIER_PQ_NEAREST_NEIGHBOR_H_
+#define OCR_CLASSIFIER_PQ_NEAREST_NEIGHBOR_H_
+
+#include "classifier/classifier.h"
+
+#include "classifier/neighbor_heap.h"
+#include "metric/pnorm_kernels.h"
+#include "util/ocrtypes.h"
+#include "util/product_quantizer.h"
+
+namespace ocr {
+
+/**
+ * A Nearest-Neighbor classifier scanning a product-quantized training set.
+ *
+ * Compresses every training entry into a code of a few bytes with a
+ * ProductQuantizer, so that a training set many times larger than with
+ * NearestNeighbor stays resident in memory and cache. Each query builds a
+ * table of its distances to the centroids once and then scans the codes,
+ * summing one table entry per byte. Optionally, the closest candidates of
+ * the scan are re-ranked with their exact Euclidean distance, which requires
+ * keeping the uncompressed training set as well.
+ */
+class PQNearestNeighbor : public ClassifierInterface {
+public:
+	/**
+	 * Constructor for the product-quantized nearest neighbor classifier
+	 *
+	 * @param[in] num_subspaces number of bytes per compressed entry
+	 * @param[in] rerank number of scan candidates re-ranked exactly (0 keeps
+	 *   only the compressed training set)
+	 * @param[in] num_centroids number of centroids per subspace (at most 256)
+	 */
+	PQNearestNeighbor( uint32_t num_subspaces = 8, uint32_t rerank = 0,
+					   uint32_t num_centroids = 256 );
+	~PQNearestNeighbor() {}
+
+	/**
+	 * Trains the classifier given a dataset and known labels for the set
+	 *
+	 * Learns the codebooks of the quantizer from the dataset and encodes it.
+	 * The dataset itself is only retained when re-ranking is enabled.
+	 *
+	 * @param[in] data_set nxm matrix with each entry in a column
+	 * @param[in] label_set mx1 vector of data_set labels
+	 */
+	void train(const arma::mat &data_set, const arma::Col<label_t> &label_set);
+	// Moved datasets are taken by the base class and trained on as above
+	using ClassifierInterface::train;
+
+	/**
+	 * Predict the label of a single vector.
+	 *
+	 * Returns the label of the training entry with the smallest approximate
+	 * Euclidean distance, or the smallest exact distance among the rerank
+	 * best approximate candidates when re-ranking is enabled.
+	 *
+	 * @param[in] predict_vector nx1 vector, whose label is desired
+	 *
+	 * @return classification label (defined by type label_t) of the input
+	 *   vector
+	 */
+	label_t predict( const arma::vec &predict_vector );
+
+	/**
+	 * Returns the number of bytes used to store the training entries
+	 *
+	 * @return size of the codes plus the size of the uncompressed training
+	 *   set if it is retained for re-ranking
+	 */
+	size_t get_memory_bytes() const;
+
+private:
+	ProductQuantizer quantizer_; /// Compresses the training entries
+	uint32_t rerank_; /// Candidates re-ranked exactly
+	arma::Mat<uint8_t> codes_; /// Code of each training entry in a column
+	arma::mat training_set_; /// Uncompressed entries (re-ranking only)
+	arma::Col<label_t> training_labels_;
+};
+
+}
+
+#endif // OCR_CLASSIFIER_PQ_NEAREST_NEIGHBOR_H_
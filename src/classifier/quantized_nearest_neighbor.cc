@@ -0,0 +1,120 @@
+#include "classifier/quantized_nearest_neighbor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+const int32_t ocr::QuantizedNearestNeighbor::kMaxQuantized;
+const arma::uword ocr::QuantizedNearestNeighbor::kPadding;
+
+ocr::QuantizedNearestNeighbor::QuantizedNearestNeighbor(
+	Quantization quantization, uint32_t p_value ) {
+	if ( p_value != 2 && ( p_value != 1 || quantization != UINT8 ) ) {
+		throw std::invalid_argument("quantized distances support p = 2, "
+			"and p = 1 for UINT8");
+	}
+
+	this->quantization_ = quantization;
+	this->p_value_ = p_value;
+	this->num_rows_ = 0;
+	this->stride_ = 0;
+}
+
+void ocr::QuantizedNearestNeighbor::train( const arma::mat &training_set,
+	const arma::Col<ocr::label_t> &training_labels ) {
+
+	this->training_labels_ = training_labels;
+	this->num_rows_ = training_set.n_rows;
+
+	if ( this->quantization_ == UINT8 ) {
+		this->training_bytes_ = arma::conv_to<arma::Mat<uint8_t>>::from(
+			arma::clamp(arma::round(training_set), 0, 255));
+		return;
+	}
+
+	// Scale each dimension by its largest magnitude, so that every dimension
+	// uses the full range of a byte
+	this->scales_ = arma::max(arma::abs(training_set), 1)/kMaxQuantized;
+	this->scales_.elem(arma::find(this->scales_ == 0)).ones();
+
+	// Entries are padded with zeros to a whole number of SIMD blocks, which
+	// leaves the inner products unchanged and skips the scalar tail
+	this->stride_ = ( this->num_rows_ + kPadding - 1 )/kPadding*kPadding;
+	this->training_signed_.assign(this->stride_*training_set.n_cols, 0);
+	this->training_norms_ = arma::vec(training_set.n_cols);
+	for ( arma::uword i = 0; i < training_set.n_cols; i++ ) {
+		int8_t *entry = &this->training_signed_[i*this->stride_];
+
+		// The norms are those of the dequantized entries, which the scan
+		// compares against
+		double norm = 0;
+		for ( arma::uword d = 0; d < this->num_rows_; d++ ) {
+			entry[d] = quantize(training_set(d, i)/this->scales_[d]);
+			double value = this->scales_[d]*entry[d];
+			norm += value*value;
+		}
+		this->training_norms_[i] = norm;
+	}
+}
+
+ocr::label_t ocr::QuantizedNearestNeighbor::predict(
+	const arma::vec &predict_vector ) {
+	const arma::uword n_train = this->training_labels_.n_elem;
+	arma::uword nearest_neighbor_index = 0;
+
+	if ( this->quantization_ == UINT8 ) {
+		const arma::Col<uint8_t> query = arma::conv_to<arma::Col<uint8_t>>::from(
+			arma::clamp(arma::round(predict_vector), 0, 255));
+		uint32_t nearest_distance = std::numeric_limits<uint32_t>::max();
+		for ( arma::uword i = 0; i < n_train; i++ ) {
+			uint32_t distance = ( this->p_value_ == 1 )
+				? ocr::kernels::manhattan_u8(query.memptr(),
+					this->training_bytes_.colptr(i), this->num_rows_)
+				: ocr::kernels::squared_euclidean_u8(query.memptr(),
+					this->training_bytes_.colptr(i), this->num_rows_);
+			if ( distance < nearest_distance ) {
+				nearest_distance = distance;
+				nearest_neighbor_index = i;
+			}
+		}
+		return this->training_labels_[nearest_neighbor_index];
+	}
+
+	// Weight the query by the scales of the training set and quantize the
+	// result with a single scale, so that the inner products are integer
+	const arma::vec weighted = predict_vector % this->scales_;
+	double query_scale = arma::max(arma::abs(weighted))/kMaxQuantized;
+	if ( query_scale == 0 ) {
+		query_scale = 1;
+	}
+	std::vector<int8_t> query = std::vector<int8_t>(this->stride_, 0);
+	for ( arma::uword d = 0; d < this->num_rows_; d++ ) {
+		query[d] = quantize(weighted[d]/query_scale);
+	}
+
+	// The squared norm of the query is identical for every training entry,
+	// so it is left out of the comparison entirely
+	double nearest_distance = std::numeric_limits<double>::max();
+	for ( arma::uword i = 0; i < n_train; i++ ) {
+		int32_t dot = ocr::kernels::dot_i8(query.data(),
+			&this->training_signed_[i*this->stride_], this->stride_);
+		double distance = this->training_norms_[i] - 2*query_scale*dot;
+		if ( distance < nearest_distance ) {
+			nearest_distance = distance;
+			nearest_neighbor_index = i;
+		}
+	}
+	return this->training_labels_[nearest_neighbor_index];
+}
+
+size_t ocr::QuantizedNearestNeighbor::get_memory_bytes() const {
+	return this->training_bytes_.n_elem*sizeof(uint8_t)
+		+ this->training_signed_.size()*sizeof(int8_t)
+		+ ( this->scales_.n_elem + this->training_norms_.n_elem )*sizeof(double);
+}
+
+int8_t ocr::QuantizedNearestNeighbor::quantize(double value) {
+	return static_cast<int8_t>(std::max<double>(-kMaxQuantized,
+		std::min<double>(kMaxQuantized, std::round(value))));
+}
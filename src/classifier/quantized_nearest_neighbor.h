@@ -0,0 +1,113 @@
+#ifndef OCR_CLASSIFIER_QUANTIZED_NEAREST_NEIGHBOR_H_
+#define OCR_CLASSIFIER_QUANTIZED_NEAREST_NEIGHBOR_H_
+
+#include "classifier/classifier.h"
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "metric/integer_kernels.h"
+#include "util/ocrtypes.h"
+
+namespace ocr {
+
+/**
+ * A Nearest-Neighbor classifier scanning a training set of bytes.
+ *
+ * Stores every training element in a single byte, an eighth of the memory
+ * scanned by NearestNeighbor, and compares entries with integer SIMD
+ * kernels. Two quantizations are available:
+ *
+ * UINT8 rounds and clamps the elements to [0, 255], which is lossless for
+ * raw pixels. The Manhattan (p = 1) and Euclidean (p = 2) distances are
+ * then computed exactly in integers, so the labels match NearestNeighbor on
+ * integer-valued data.
+ *
+ * INT8 is meant for PCA projections, whose dimensions have very different
+ * ranges. Each dimension d of the training set gets its own scale s_d, with
+ * x_d ~ s_d*q_d for q_d in [-127, 127]. A query y is weighted by the scales
+ * and quantized with a single scale t, so that the inner product
+ * \f$ x^Ty = \Sigma_d s_d q_d y_d \f$ is approximated by t times an integer
+ * inner product of bytes, and the Euclidean distance follows from
+ * \f$ \|x-y\|^2 = \|x\|^2 + \|y\|^2 - 2x^Ty \f$. Only p = 2 is supported.
+ */
+class QuantizedNearestNeighbor : public ClassifierInterface {
+public:
+	/**
+	 * Enumeration of the ways of storing the training elements
+	 */
+	enum Quantization {
+		UINT8,
+		INT8
+	};
+
+	/**
+	 * Constructor for the quantized nearest neighbor classifier
+	 *
+	 * @param[in] quantization storage of the training elements
+	 * @param[in] p_value p of the p-norm (1 or 2 for UINT8, 2 for INT8)
+	 */
+	QuantizedNearestNeighbor( Quantization quantization = UINT8,
+							  uint32_t p_value = 2 );
+	~QuantizedNearestNeighbor() {}
+
+	/**
+	 * Trains the classifier given a dataset and known labels for the set
+	 *
+	 * Quantizes and stores the dataset; the dataset itself is not retained.
+	 *
+	 * @param[in] data_set nxm matrix with each entry in a column
+	 * @param[in] label_set mx1 vector of data_set labels
+	 */
+	void train(const arma::mat &data_set, const arma::Col<label_t> &label_set);
+	// Moved datasets are taken by the base class and trained on as above
+	using ClassifierInterface::train;
+
+	/**
+	 * Predict the label of a single vector.
+	 *
+	 * Quantizes the query as the training set and returns the label of the
+	 * nearest quantized training entry.
+	 *
+	 * @param[in] predict_vector nx1 vector, whose label is desired
+	 *
+	 * @return classification label (defined by type label_t) of the input
+	 *   vector
+	 */
+	label_t predict( const arma::vec &predict_vector );
+
+	/**
+	 * Returns the number of bytes used to store the training entries
+	 *
+	 * @return size of the quantized entries, their norms and the scales
+	 */
+	size_t get_memory_bytes() const;
+
+private:
+	static const int32_t kMaxQuantized = 127; /// Largest INT8 magnitude
+	static const arma::uword kPadding = 16; /// INT8 entry size multiple
+
+	/**
+	 * Round a scaled value to the nearest signed byte in [-127, 127]
+	 *
+	 * @param[in] value value divided by its scale
+	 *
+	 * @return quantized value
+	 */
+	static int8_t quantize(double value);
+
+	Quantization quantization_;
+	uint32_t p_value_;
+	arma::uword num_rows_; /// Number of elements of each entry
+	arma::Mat<uint8_t> training_bytes_; /// UINT8 entries in columns
+	arma::uword stride_; /// Padded size of each INT8 entry
+	std::vector<int8_t> training_signed_; /// INT8 entries, one after another
+	arma::vec scales_; /// INT8 scale of each dimension
+	arma::vec training_norms_; /// INT8 squared norms of the entries
+	arma::Col<label_t> training_labels_;
+};
+
+}
+
+#endif // OCR_CLASSIFIER_QUANTIZED_NEAREST_NEIGHBOR_H_
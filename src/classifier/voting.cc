@@ -0,0 +1,131 @@
+#include "classifier/voting.h"
+
+#include <stdexcept>
+
+namespace {
+
+/**
+ * Reject an empty neighborhood, as found with an empty training set
+ */
+void require_neighbors( const std::vector<ocr::Neighbor> &neighbors ) {
+	if ( neighbors.empty() ) {
+		throw std::invalid_argument("cannot vote without neighbors");
+	}
+}
+
+}
+
+ocr::label_t ocr::majority_vote( const std::vector<ocr::Neighbor> &neighbors,
+	const arma::Col<ocr::label_t> &labels ) {
+
+	require_neighbors(neighbors);
+
+	ocr::label_t best_label = labels[neighbors[0].index];
+	size_t best_count = 0;
+	for ( size_t i = 0; i < neighbors.size(); i++ ) {
+		ocr::label_t label = labels[neighbors[i].index];
+		size_t count = 0;
+		for ( size_t j = 0; j < neighbors.size(); j++ ) {
+			count += ( labels[neighbors[j].index] == label );
+		}
+		if ( count > best_count ) {
+			best_count = count;
+			best_label = label;
+		}
+	}
+
+	return best_label;
+}
+
+ocr::label_t ocr::weighted_vote( const std::vector<ocr::Neighbor> &neighbors,
+	const arma::Col<ocr::label_t> &labels ) {
+
+	require_neighbors(neighbors);
+
+	// Exact matches are counted separately so that they outweigh any finite
+	// weight
+	std::map<ocr::label_t, std::pair<size_t, double>> weights;
+	for ( const ocr::Neighbor &neighbor : neighbors ) {
+		std::pair<size_t, double> &weight = weights[labels[neighbor.index]];
+		if ( neighbor.distance <= 0 ) {
+			weight.first++;
+		}
+		else {
+			weight.second += 1/neighbor.distance;
+		}
+	}
+
+	ocr::label_t best_label = labels[neighbors[0].index];
+	std::pair<size_t, double> best_weight = std::make_pair(0, 0.);
+	for ( const ocr::Neighbor &neighbor : neighbors ) {
+		ocr::label_t label = labels[neighbor.index];
+		if ( weights[label] > best_weight ) {
+			best_weight = weights[label];
+			best_label = label;
+		}
+	}
+
+	return best_label;
+}
+
+ocr::label_t ocr::tie_break_vote( const std::vector<ocr::Neighbor> &neighbors,
+	const arma::Col<ocr::label_t> &labels ) {
+
+	require_neighbors(neighbors);
+
+	std::map<ocr::label_t, size_t> counts;
+	for ( const ocr::Neighbor &neighbor : neighbors ) {
+		counts[labels[neighbor.index]]++;
+	}
+
+	for ( size_t n = neighbors.size(); n > 1; n-- ) {
+		ocr::label_t best_label = 0;
+		size_t best_count = 0;
+		bool tied = false;
+		for ( const auto &count : counts ) {
+			if ( count.second > best_count ) {
+				best_label = count.first;
+				best_count = count.second;
+				tied = false;
+			}
+			else if ( count.second == best_count ) {
+				tied = true;
+			}
+		}
+		if ( !tied ) {
+			return best_label;
+		}
+		counts[labels[neighbors[n-1].index]]--;
+	}
+
+	return labels[neighbors[0].index];
+}
+
+ocr::label_t ocr::vote( const std::vector<ocr::Neighbor> &neighbors,
+	const arma::Col<ocr::label_t> &labels, ocr::VotingRule rule ) {
+
+	switch ( rule ) {
+		case DISTANCE_WEIGHTED:
+			return weighted_vote(neighbors, labels);
+		case TIE_BREAK:
+			return tie_break_vote(neighbors, labels);
+		case MAJORITY:
+		default:
+			return majority_vote(neighbors, labels);
+	}
+}
+
+double ocr::label_share( const std::vector<ocr::Neighbor> &neighbors,
+	const arma::Col<ocr::label_t> &labels, ocr::label_t label, size_t &nearest ) {
+
+	nearest = neighbors.size();
+	size_t count = 0;
+	for ( size_t i = 0; i < neighbors.size(); i++ ) {
+		if ( labels[neighbors[i].index] == label ) {
+			nearest = std::min(nearest, i);
+			count++;
+		}
+	}
+
+	return neighbors.empty() ? 0. : 1.0*count/neighbors.size();
+}
@@ -0,0 +1,109 @@
+#ifndef OCR_CLASSIFIER_VOTING_H_
+#define OCR_CLASSIFIER_VOTING_H_
+
+#include <float.h>
+
+#include <map>
+#include <vector>
+
+#include <armadillo>
+
+#include "classifier/neighbor_heap.h"
+#include "util/ocrtypes.h"
+
+namespace ocr {
+
+/**
+ * Rules for combining the labels of several neighbors into one label
+ *
+ * MAJORITY returns the most frequent label, breaking ties in favor of the
+ * nearest tied neighbor. DISTANCE_WEIGHTED weighs each vote by the inverse
+ * of the neighbor's distance. TIE_BREAK returns the most frequent label and
+ * resolves ties by dropping the farthest neighbor and voting again.
+ */
+enum VotingRule {
+	MAJORITY,
+	DISTANCE_WEIGHTED,
+	TIE_BREAK
+};
+
+/**
+ * Majority vote among neighbors
+ *
+ * Returns the label held by most of the neighbors. Scanning from the nearest
+ * neighbor outward and only replacing the winner on a strictly larger count
+ * breaks ties in favor of the label of the nearest tied entry.
+ *
+ * @param[in] neighbors neighbors ordered from nearest to farthest
+ * @param[in] labels labels indexed by the neighbors' indices
+ *
+ * @return label of the majority of the neighbors
+ */
+label_t majority_vote( const std::vector<Neighbor> &neighbors,
+					   const arma::Col<label_t> &labels );
+
+/**
+ * Distance-weighted vote among neighbors
+ *
+ * Each neighbor votes for its label with a weight of one over its distance.
+ * Neighbors at distance zero outweigh every other neighbor. Ties are broken
+ * in favor of the label of the nearest tied entry.
+ *
+ * @param[in] neighbors neighbors ordered from nearest to farthest
+ * @param[in] labels labels indexed by the neighbors' indices
+ *
+ * @return label with the largest total weight
+ */
+label_t weighted_vote( const std::vector<Neighbor> &neighbors,
+					   const arma::Col<label_t> &labels );
+
+/**
+ * Majority vote resolving ties by shrinking the neighborhood
+ *
+ * Returns the label held by most of the neighbors. While several labels are
+ * tied for the largest count, the farthest neighbor is dropped and the vote
+ * is repeated, down to the single nearest neighbor.
+ *
+ * @param[in] neighbors neighbors ordered from nearest to farthest
+ * @param[in] labels labels indexed by the neighbors' indices
+ *
+ * @return label of the majority of the neighbors
+ */
+label_t tie_break_vote( const std::vector<Neighbor> &neighbors,
+						const arma::Col<label_t> &labels );
+
+/**
+ * Vote among neighbors with the specified rule
+ *
+ * Every rule throws std::invalid_argument when there are no neighbors,
+ * such as for a classifier trained on an empty training set.
+ *
+ * @param[in] neighbors neighbors ordered from nearest to farthest
+ * @param[in] labels labels indexed by the neighbors' indices
+ * @param[in] rule rule combining the labels
+ *
+ * @return label selected by the rule
+ */
+label_t vote( const std::vector<Neighbor> &neighbors,
+			  const arma::Col<label_t> &labels, VotingRule rule );
+
+/**
+ * Fraction of the neighbors holding a label
+ *
+ * Serves as the confidence of a label chosen by a vote.
+ *
+ * @param[in] neighbors neighbors ordered from nearest to farthest
+ * @param[in] labels labels indexed by the neighbors' indices
+ * @param[in] label label whose share is desired
+ * @param[out] nearest position in neighbors of the nearest neighbor holding
+ *   the label (neighbors.size() if none holds it)
+ *
+ * @return fraction of the neighbors holding the label in [0, 1]
+ */
+double label_share( const std::vector<Neighbor> &neighbors,
+					const arma::Col<label_t> &labels, label_t label,
+					size_t &nearest );
+
+}
+
+#endif // OCR_CLASSIFIER_VOTING_H_
@@ -0,0 +1,172 @@
+#include "classifier/vp_tree.h"
+
+ocr::VPTree::VPTree( ocr::Metric *metric, uint32_t k, arma::uword leaf_size ) {
+	if ( k == 0 ) {
+		throw std::invalid_argument("k must be positive");
+	}
+
+	this->metric_ = metric;
+	this->k_ = k;
+	this->leaf_size_ = std::max<arma::uword>(leaf_size, 1);
+	this->queries_ = 0;
+	this->skipped_ = 0;
+}
+
+void ocr::VPTree::train( const arma::mat &training_set,
+	const arma::Col<ocr::label_t> &training_labels ) {
+
+	std::vector<arma::uword> order(training_set.n_cols);
+	for ( arma::uword i = 0; i < order.size(); i++ ) {
+		order[i] = i;
+	}
+
+	// A fixed seed keeps the tree, and therefore the statistics, identical
+	// between runs
+	this->generator_.seed(0);
+	this->nodes_.clear();
+	if ( !order.empty() ) {
+		build(0, order.size(), order, training_set);
+	}
+
+	this->indices_ = arma::uvec(order);
+	this->points_ = training_set.cols(this->indices_);
+	this->labels_ = training_labels;
+	reset_statistics();
+}
+
+ocr::label_t ocr::VPTree::predict( const arma::vec &predict_vector ) {
+	std::vector<ocr::Neighbor> neighbors = nearest_neighbors(predict_vector);
+	return ocr::majority_vote(neighbors, this->labels_);
+}
+
+ocr::label_t ocr::VPTree::predict_scored( const arma::vec &predict_vector,
+	double &distance, double &confidence ) {
+	std::vector<ocr::Neighbor> neighbors = nearest_neighbors(predict_vector);
+	ocr::label_t label = ocr::majority_vote(neighbors, this->labels_);
+
+	size_t nearest;
+	confidence = ocr::label_share(neighbors, this->labels_, label, nearest);
+	distance = neighbors[nearest].distance;
+	return label;
+}
+
+std::vector<ocr::Neighbor> ocr::VPTree::nearest_neighbors(
+	const arma::vec &query, size_t *skipped ) {
+
+	ocr::NeighborHeap heap = ocr::NeighborHeap(this->k_);
+	size_t evaluations = 0;
+	if ( !this->nodes_.empty() ) {
+		search(0, query, heap, evaluations);
+	}
+
+	size_t query_skipped = this->points_.n_cols - evaluations;
+	this->queries_ += 1;
+	this->skipped_ += query_skipped;
+	if ( skipped != nullptr ) {
+		*skipped = query_skipped;
+	}
+
+	std::vector<ocr::Neighbor> neighbors = heap.sorted();
+	for ( auto &neighbor : neighbors ) {
+		neighbor.index = this->indices_[neighbor.index];
+	}
+	return neighbors;
+}
+
+double ocr::VPTree::get_mean_skipped() const {
+	uint64_t queries = this->queries_;
+	return queries == 0 ? 0. : 1.0*this->skipped_/queries;
+}
+
+void ocr::VPTree::reset_statistics() {
+	this->queries_ = 0;
+	this->skipped_ = 0;
+}
+
+int64_t ocr::VPTree::build( arma::uword begin, arma::uword end,
+	std::vector<arma::uword> &order, const arma::mat &training_set ) {
+
+	int64_t node_index = this->nodes_.size();
+	this->nodes_.push_back(Node{begin, end, 0., 0., -1, -1});
+	if ( end - begin <= this->leaf_size_ ) {
+		return node_index;
+	}
+
+	// Move a random vantage entry to the front of the range
+	std::uniform_int_distribution<arma::uword> pick(begin, end-1);
+	std::swap(order[begin], order[pick(this->generator_)]);
+	const arma::vec vantage = training_set.col(order[begin]);
+
+	std::vector<std::pair<double, arma::uword>> distances;
+	distances.reserve(end - begin - 1);
+	for ( arma::uword i = begin+1; i < end; i++ ) {
+		distances.push_back(std::make_pair(
+			this->metric_->distance(vantage, training_set.unsafe_col(order[i])),
+			order[i]));
+	}
+
+	size_t middle = distances.size()/2;
+	std::nth_element(distances.begin(), distances.begin() + middle,
+		distances.end());
+
+	double inside_max = 0.;
+	for ( size_t i = 0; i < middle; i++ ) {
+		inside_max = std::max(inside_max, distances[i].first);
+	}
+	double outside_min = distances[middle].first;
+
+	for ( size_t i = 0; i < distances.size(); i++ ) {
+		order[begin+1+i] = distances[i].second;
+	}
+
+	arma::uword split = begin + 1 + middle;
+	int64_t inside = ( split > begin+1 ) ? build(begin+1, split, order, training_set) : -1;
+	int64_t outside = build(split, end, order, training_set);
+
+	Node &node = this->nodes_[node_index];
+	node.inside_max = inside_max;
+	node.outside_min = outside_min;
+	node.inside = inside;
+	node.outside = outside;
+
+	return node_index;
+}
+
+void ocr::VPTree::search( int64_t node_index, const arma::vec &query,
+	ocr::NeighborHeap &heap, size_t &evaluations ) {
+
+	const Node &node = this->nodes_[node_index];
+
+	if ( node.outside < 0 ) {
+		for ( arma::uword i = node.begin; i < node.end; i++ ) {
+			heap.push(this->metric_->distance(query, this->points_.unsafe_col(i)), i);
+		}
+		evaluations += node.end - node.begin;
+		return;
+	}
+
+	const double distance =
+		this->metric_->distance(query, this->points_.unsafe_col(node.begin));
+	evaluations++;
+	heap.push(distance, node.begin);
+
+	// By the triangle inequality every inside entry x satisfies
+	// d(q,x) >= d(q,v) - inside_max and every outside entry satisfies
+	// d(q,x) >= outside_min - d(q,v)
+	if ( distance < node.outside_min ) {
+		if ( node.inside >= 0 && distance - heap.bound() <= node.inside_max ) {
+			search(node.inside, query, heap, evaluations);
+		}
+		if ( distance + heap.bound() >= node.outside_min ) {
+			search(node.outside, query, heap, evaluations);
+		}
+	}
+	else {
+		if ( distance + heap.bound() >= node.outside_min ) {
+			search(node.outside, query, heap, evaluations);
+		}
+		if ( node.inside >= 0 && distance - heap.bound() <= node.inside_max ) {
+			search(node.inside, query, heap, evaluations);
+		}
+	}
+}
@@ -0,0 +1,176 @@
+#ifndef OCR_CLASSIFIER_VP_TREE_H_
+#define OCR_CLASSIFIER_VP_TREE_H_
+
+#include "classifier/classifier.h"
+
+#include <atomic>
+#include <random>
+#include <vector>
+
+#include "classifier/neighbor_heap.h"
+#include "classifier/voting.h"
+#include "metric/metric.h"
+#include "metric/pnorm_metric.h"
+#include "util/ocrtypes.h"
+
+namespace ocr {
+
+/**
+ * A k-Nearest-Neighbor classifier searching a vantage-point tree.
+ *
+ * Builds a vantage-point tree over the training set when trained. Each node
+ * picks a vantage entry and splits the remaining entries by their distance
+ * to it, so the tree only relies on Metric::distance. Queries prune every
+ * subtree that the triangle inequality proves cannot hold a closer entry
+ * than the current k-th best neighbor, which makes the search exact for any
+ * metric, including custom ones.
+ *
+ * The classifier counts the distance evaluations of every query so that the
+ * effect of the pruning can be measured.
+ */
+class VPTree : public ClassifierInterface {
+public:
+	/**
+	 * Constructor for the vantage-point tree classifier
+	 *
+	 * @param[in] metric a metric satisfying the triangle inequality
+	 * @param[in] k number of neighbors that vote on a label
+	 * @param[in] leaf_size maximum number of training entries in a leaf
+	 */
+	VPTree( Metric *metric = new PNorm(), uint32_t k = 1,
+			arma::uword leaf_size = 8 );
+	~VPTree() {}
+
+	/**
+	 * Trains the classifier given a dataset and known labels for the set
+	 *
+	 * Builds the tree by recursively choosing a random vantage entry and
+	 * splitting the remaining entries at the median of their distances to it
+	 * until each leaf holds at most leaf_size entries. Resets the distance
+	 * evaluation statistics.
+	 *
+	 * @param[in] data_set nxm matrix with each entry in a column
+	 * @param[in] label_set mx1 vector of data_set labels
+	 */
+	void train(const arma::mat &data_set, const arma::Col<label_t> &label_set);
+	// Moved datasets are taken by the base class and trained on as above
+	using ClassifierInterface::train;
+
+	/**
+	 * Predict the label of a single vector.
+	 *
+	 * Finds the k nearest training entries and returns the label held by
+	 * most of them. Ties are broken in favor of the label of the nearest
+	 * entry among the tied labels.
+	 *
+	 * @param[in] predict_vector nx1 vector, whose label is desired
+	 *
+	 * @return classification label (defined by type label_t) of the input
+	 *   vector
+	 */
+	label_t predict( const arma::vec &predict_vector );
+
+	/**
+	 * Find the k nearest training entries of a vector
+	 *
+	 * @param[in] query nx1 vector whose neighbors are desired
+	 * @param[out] skipped number of training entries whose distance to the
+	 *   query was never evaluated (optional)
+	 *
+	 * @return the k nearest neighbors ordered from nearest to farthest, with
+	 *   indices into the columns of the training set
+	 */
+	std::vector<Neighbor> nearest_neighbors( const arma::vec &query,
+											 size_t *skipped = nullptr );
+
+	/**
+	 * Returns the mean number of skipped distance evaluations per query
+	 *
+	 * Averages, over every query since the last train or
+	 * reset_statistics, the number of training entries whose distance to the
+	 * query was never evaluated. A linear scan skips none.
+	 *
+	 * @return mean skipped distance evaluations per query
+	 */
+	double get_mean_skipped() const;
+
+	/**
+	 * Resets the distance evaluation statistics
+	 */
+	void reset_statistics();
+
+protected:
+	/**
+	 * Predict the label of a single vector along with its scores
+	 *
+	 * The distance is that of the nearest neighbor holding the label, and the
+	 * confidence is the fraction of the k neighbors holding it.
+	 *
+	 * @param[in] predict_vector nx1 vector, whose label is desired
+	 * @param[out] distance distance to the nearest neighbor holding the label
+	 * @param[out] confidence fraction of the neighbors holding the label
+	 *
+	 * @return classification label (defined by type label_t) of the input
+	 *   vector
+	 */
+	label_t predict_scored( const arma::vec &predict_vector, double &distance,
+							double &confidence );
+
+private:
+	/**
+	 * A node of the tree
+	 *
+	 * Covers the training entries in [begin, end) of the reordered training
+	 * set. The vantage entry of an inner node is stored at begin; the
+	 * entries closer to it than the median distance form the inside subtree
+	 * and the remaining ones the outside subtree. Leaves have no children.
+	 */
+	struct Node {
+		arma::uword begin;
+		arma::uword end;
+		double inside_max; /// Largest distance from the vantage to inside
+		double outside_min; /// Smallest distance from the vantage to outside
+		int64_t inside;
+		int64_t outside;
+	};
+
+	/**
+	 * Recursively build the subtree over a range of the index permutation
+	 *
+	 * @param[in] begin first position in the permutation
+	 * @param[in] end one past the last position in the permutation
+	 * @param[in,out] order permutation of training entry indices
+	 * @param[in] data_set nxm matrix with each entry in a column
+	 *
+	 * @return index of the subtree's root in nodes_
+	 */
+	int64_t build( arma::uword begin, arma::uword end,
+				   std::vector<arma::uword> &order, const arma::mat &data_set );
+
+	/**
+	 * Recursively search a subtree
+	 *
+	 * @param[in] node index of the subtree's root
+	 * @param[in] query nx1 query vector
+	 * @param[in,out] heap nearest neighbors found so far
+	 * @param[in,out] evaluations number of distances evaluated
+	 */
+	void search( int64_t node, const arma::vec &query, NeighborHeap &heap,
+				 size_t &evaluations );
+
+	Metric *metric_; /// Distance between entries
+	uint32_t k_; /// Number of voting neighbors
+	arma::uword leaf_size_; /// Maximum entries per leaf
+	std::mt19937 generator_; /// Selects the vantage entries
+	std::vector<Node> nodes_; /// Tree nodes, root first
+	arma::mat points_; /// Training entries in tree order
+	arma::Col<label_t> labels_; /// Labels of the training entries
+	arma::uvec indices_; /// Original column of each entry in tree order
+
+	std::atomic<uint64_t> queries_; /// Queries since the last reset
+	std::atomic<uint64_t> skipped_; /// Skipped evaluations since the last reset
+};
+
+}
+
+#endif // OCR_CLASSIFIER_VP_TREE_H_
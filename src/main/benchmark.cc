@@ -1,9 +1,18 @@
 #include <chrono>
+#include <future>
 #include <iostream>
 
+#include "classifier/hnsw.h"
+#include "classifier/k_nearest_neighbor.h"
+#include "classifier/kd_tree.h"
 #include "classifier/nearest_neighbor.h"
+#include "classifier/pipeline.h"
+#include "classifier/pq_nearest_neighbor.h"
+#include "classifier/quantized_nearest_neighbor.h"
+#include "classifier/vp_tree.h"
 #include "metric/pnorm_metric.h"
-#include "parser/mnist_parser.h"
+#include "parser/dataset_cache.h"
+#include "parser/dataset_loader.h"
 #include "util/timer.h"
 
 #include "util/principle_component_analysis.h"
@@ -21,6 +30,11 @@ int main() {
 	ocr::Metric *metric_manhattan = new ocr::PNorm(1);
 	ocr::NearestNeighbor *nn_manhattan = new ocr::NearestNeighbor(metric_manhattan);
 
+	// Manhattan-norm Nearest-Neighbor abandoning candidates early, with the
+	// dimensions visited in decreasing order of variance
+	ocr::NearestNeighbor *nn_manhattan_abandon = new ocr::NearestNeighbor(metric_manhattan);
+	nn_manhattan_abandon->set_early_abandon(true, true);
+
 	// Euclidean-norm Nearest-Neighbor
 	ocr::Metric *metric_euclidean = new ocr::PNorm(2);
 	ocr::NearestNeighbor *nn_euclidean = new ocr::NearestNeighbor(metric_euclidean);
@@ -29,52 +43,155 @@ int main() {
 	ocr::Metric *metric_3norm = new ocr::PNorm(3);
 	ocr::NearestNeighbor *nn_3norm = new ocr::NearestNeighbor(metric_3norm);
 
+	// Euclidean-norm distance-weighted 3-Nearest-Neighbor
+	ocr::KNearestNeighbor *knn_euclidean =
+		new ocr::KNearestNeighbor(3, metric_euclidean, ocr::DISTANCE_WEIGHTED);
+
+	// Euclidean-norm Nearest-Neighbor searching a k-d tree
+	ocr::KDTree *kd_euclidean = new ocr::KDTree(1, 2);
+
+	// Manhattan-norm Nearest-Neighbor searching a vantage-point tree
+	ocr::VPTree *vp_manhattan = new ocr::VPTree(metric_manhattan);
+
+	// Approximate Euclidean-norm Nearest-Neighbor searching an HNSW graph
+	ocr::HNSW *hnsw_euclidean = new ocr::HNSW(metric_euclidean);
+
+	// Euclidean-norm Nearest-Neighbor over an 8-byte product-quantized
+	// training set, re-ranking the 32 best candidates exactly
+	ocr::PQNearestNeighbor *pq_euclidean = new ocr::PQNearestNeighbor(8, 32);
+
+	// Euclidean-norm Nearest-Neighbor over a training set quantized to one
+	// signed byte per dimension
+	ocr::QuantizedNearestNeighbor *int8_euclidean =
+		new ocr::QuantizedNearestNeighbor(ocr::QuantizedNearestNeighbor::INT8);
+
 	// Create a list of all the classifiers with an identifiable name for easier
 	// comparison of output values. Uses the NamedClassifier typedef 
 	std::vector<NamedClassifier> classifiers = std::vector<NamedClassifier>();
 	classifiers.push_back(NamedClassifier("Manhattan Nearest-Neighbor", nn_manhattan));
+	classifiers.push_back(NamedClassifier("Manhattan NN (Early Abandon)", nn_manhattan_abandon));
 	classifiers.push_back(NamedClassifier("Euclidean Nearest-Neighbor", nn_euclidean));
+	classifiers.push_back(NamedClassifier("Euclidean 3-NN (Weighted)", knn_euclidean));
+	classifiers.push_back(NamedClassifier("Euclidean k-d Tree\t", kd_euclidean));
+	classifiers.push_back(NamedClassifier("Manhattan VP Tree\t", vp_manhattan));
+	classifiers.push_back(NamedClassifier("Euclidean HNSW\t\t", hnsw_euclidean));
+	classifiers.push_back(NamedClassifier("Euclidean PQ (8 bytes)\t", pq_euclidean));
+	classifiers.push_back(NamedClassifier("Euclidean NN (int8)\t", int8_euclidean));
 	// classifiers.push_back(NamedClassifier("3-Norm Nearest-Neighbor", nn_3norm));
 
-	// Load the MNist data
-	arma::mat mnist_train_images = ocr::mnist::parse_images(
-									"data/train-images-idx3-ubyte");
-	arma::Col<ocr::label_t> mnist_train_labels = ocr::mnist::parse_labels(
-									"data/train-labels-idx1-ubyte");
-	arma::mat mnist_test_images = ocr::mnist::parse_images(
-									"data/t10k-images-idx3-ubyte");
-	arma::Col<ocr::label_t> mnist_test_labels = ocr::mnist::parse_labels(
-									"data/t10k-labels-idx1-ubyte");
-
-	// Compute the PCA
+	// Reuse the labels, PCA and its projections of a previous run if the
+	// dataset files and PCA parameters are unchanged, so that the classifiers
+	// start without parsing the files or solving the PCA again. The raw images
+	// are kept as well, as bytes, for the fused pipeline and the comparison of
+	// the quantized classifiers
+	const std::vector<std::string> mnist_files = {
+		"data/train-images-idx3-ubyte", "data/train-labels-idx1-ubyte",
+		"data/t10k-images-idx3-ubyte", "data/t10k-labels-idx1-ubyte"};
+	const std::string mnist_cache_file = "data/mnist.cache";
+	timer.start();
+	const uint64_t cache_key = ocr::DatasetCache::hash(mnist_files, "pca:56");
+	ocr::DatasetCache cache(mnist_cache_file);
+
+	const std::vector<std::string> mnist_cache_names = {"projection",
+		"train_images", "train_images_reduced", "train_labels", "test_images",
+		"test_images_reduced", "test_labels"};
+	bool cache_hit = cache.is_open() && cache.get_key() == cache_key;
+	for ( auto &name : mnist_cache_names ) {
+		cache_hit = cache_hit && cache.contains(name);
+	}
+
 	// Uses a value determined iteratively in previous work
-	// The current PCA dimension decision implementation provides a value too
-	// large and as the value is known, I have decided not to use the dimension
-	// decision yet.
 	ocr::PCA pca = ocr::PCA(56);
-	pca.solve(mnist_train_images);
-	// std::cout << pca.get_dimensions() << "\t" << pca.get_percent_variability() << std::endl;
-	std::cout << "Principle Component Analysis" << std::endl;
-	std::cout << "Method" << "\t\t" << "Dimensions" << "\t" << "Variability (%)" << "\t" << "Time (ms)" << std::endl;
-	std::cout << "Auto" << "\t\t" << std::flush;
-	pca.set_auto_dimension();
-	timer.start();
-	pca.solve(mnist_train_images);
-	std::cout << pca.get_dimensions() << "\t\t";
-	std::cout << pca.get_percent_variability() << "\t\t";
-	std::cout << timer.elapsed_ms().count() << std::endl;
-	std::cout << "Known Optimal" << "\t" << std::flush;
-	pca.set_dimensions(56);
-	timer.start();
-	pca.solve(mnist_train_images);
-	std::cout << pca.get_dimensions() << "\t\t";
-	std::cout << pca.get_percent_variability() << "\t\t";
-	std::cout << timer.elapsed_ms().count() << std::endl;
-	std::cout << std::endl;
+	arma::Mat<uint8_t> mnist_train_pixels;
+	arma::mat mnist_train_images_reduced;
+	arma::mat mnist_test_images;
+	arma::mat mnist_test_images_reduced;
+	arma::Col<ocr::label_t> mnist_train_labels;
+	arma::Col<ocr::label_t> mnist_test_labels;
 
-	// Reduce the dataset using the computed PCA
-	arma::mat mnist_train_images_reduced = pca.project(mnist_train_images);
-	arma::mat mnist_test_images_reduced = pca.project(mnist_test_images);
+	if ( cache_hit ) {
+		pca.set_projection_matrix(cache.get<double>("projection"));
+		mnist_train_pixels = cache.get<uint8_t>("train_images");
+		mnist_train_images_reduced = cache.get<double>("train_images_reduced");
+		mnist_train_labels = cache.get<ocr::label_t>("train_labels");
+		mnist_test_images = arma::conv_to<arma::mat>::from(
+			cache.get<uint8_t>("test_images"));
+		mnist_test_images_reduced = cache.get<double>("test_images_reduced");
+		mnist_test_labels = cache.get<ocr::label_t>("test_labels");
+		std::cout << "Loaded PCA projections from " << mnist_cache_file << " in "
+			<< timer.elapsed_ms().count() << " ms" << std::endl << std::endl;
+	}
+	else {
+		// Load the MNist data, reading and decoding the four files concurrently.
+		// The training images are needed first, by the PCA, while the rest of the
+		// files are still being decoded in the background
+		ocr::DatasetLoader loader;
+		std::future<arma::mat> mnist_train_images_future =
+			loader.load_images(mnist_files[0]);
+		std::future<arma::Col<ocr::label_t>> mnist_train_labels_future =
+			loader.load_labels(mnist_files[1]);
+		std::future<arma::mat> mnist_test_images_future =
+			loader.load_images(mnist_files[2]);
+		std::future<arma::Col<ocr::label_t>> mnist_test_labels_future =
+			loader.load_labels(mnist_files[3]);
+		arma::mat mnist_train_images = mnist_train_images_future.get();
+
+		// Compute the PCA
+		// The current PCA dimension decision implementation provides a value too
+		// large and as the value is known, I have decided not to use the dimension
+		// decision yet.
+		pca.solve(mnist_train_images);
+		// std::cout << pca.get_dimensions() << "\t" << pca.get_percent_variability() << std::endl;
+		std::cout << "Principle Component Analysis" << std::endl;
+		std::cout << "Method" << "\t\t" << "Dimensions" << "\t" << "Variability (%)" << "\t" << "Time (ms)" << std::endl;
+		std::cout << "Auto" << "\t\t" << std::flush;
+		pca.set_auto_dimension();
+		timer.start();
+		pca.solve(mnist_train_images);
+		std::cout << pca.get_dimensions() << "\t\t";
+		std::cout << pca.get_percent_variability() << "\t\t";
+		std::cout << timer.elapsed_ms().count() << std::endl;
+		std::cout << "Known Optimal" << "\t" << std::flush;
+		pca.set_dimensions(56);
+		timer.start();
+		pca.solve(mnist_train_images);
+		std::cout << pca.get_dimensions() << "\t\t";
+		std::cout << pca.get_percent_variability() << "\t\t";
+		std::cout << timer.elapsed_ms().count() << std::endl;
+		std::cout << "Randomized" << "\t" << std::flush;
+		ocr::PCA pca_randomized = ocr::PCA(56);
+		pca_randomized.set_solver(ocr::PCA::RANDOMIZED_SOLVER);
+		timer.start();
+		pca_randomized.solve(mnist_train_images);
+		std::cout << pca_randomized.get_dimensions() << "\t\t";
+		std::cout << pca_randomized.get_percent_variability() << "\t\t";
+		std::cout << timer.elapsed_ms().count() << std::endl;
+		std::cout << "Randomized subspace distance from exact: "
+			<< pca_randomized.subspace_distance(pca) << std::endl;
+		std::cout << std::endl;
+
+		// Reduce the dataset using the computed PCA
+		mnist_train_images_reduced = pca.project(mnist_train_images);
+		mnist_train_pixels = arma::conv_to<arma::Mat<uint8_t>>::from(mnist_train_images);
+		mnist_train_images.reset();
+		mnist_test_images = mnist_test_images_future.get();
+		mnist_test_images_reduced = pca.project(mnist_test_images);
+
+		mnist_train_labels = mnist_train_labels_future.get();
+		mnist_test_labels = mnist_test_labels_future.get();
+
+		// Store the reduced dataset for the next run
+		ocr::DatasetCacheWriter cache_writer;
+		cache_writer.add("projection", pca.get_projection_matrix());
+		cache_writer.add("train_images", mnist_train_pixels);
+		cache_writer.add("train_images_reduced", mnist_train_images_reduced);
+		cache_writer.add("train_labels", mnist_train_labels);
+		cache_writer.add("test_images",
+			arma::conv_to<arma::Mat<uint8_t>>::from(mnist_test_images));
+		cache_writer.add("test_images_reduced", mnist_test_images_reduced);
+		cache_writer.add("test_labels", mnist_test_labels);
+		cache_writer.write(mnist_cache_file, cache_key);
+	}
 
 	// Print out a table of train/test times as well as error rate for each
 	// algorithm that is used
@@ -82,6 +199,9 @@ int main() {
 	for ( auto c : classifiers ) {
 		std::cout << c.first << "\t" << std::flush;
 
+		// Split the test queries across every available core
+		c.second->set_num_threads(0);
+
 		timer.start();
 		c.second->train(mnist_train_images_reduced, mnist_train_labels);
 		std::cout << timer.elapsed_ms().count() << "\t\t" << std::flush;
@@ -94,4 +214,123 @@ int main() {
 
 		std::cout << std::endl;
 	}
+
+	// Classify the raw test images through the PCA, projecting them in blocks
+	// rather than as a whole matrix, and compare to projecting the whole test
+	// set before classifying it
+	std::cout << std::endl;
+	std::cout << "Projection" << "\t\t\t" << "Testing (ms)" << "\t" << "Error Rate" << std::endl;
+	nn_euclidean->set_num_threads(0);
+	std::cout << "Whole Matrix\t\t\t" << std::flush;
+	timer.start();
+	double error_rate_whole = nn_euclidean->validate(
+		pca.project(mnist_test_images), mnist_test_labels);
+	std::cout << timer.elapsed_ms().count() << "\t\t" << error_rate_whole
+		<< std::endl;
+	ocr::Pipeline pipeline(&pca, nn_euclidean);
+	pipeline.set_num_threads(0);
+	std::cout << "Fused Pipeline\t\t\t" << std::flush;
+	timer.start();
+	double error_rate_fused = pipeline.validate(mnist_test_images,
+		mnist_test_labels);
+	std::cout << timer.elapsed_ms().count() << "\t\t" << error_rate_fused
+		<< std::endl;
+
+	// Classify in single precision, which halves the memory traffic of the
+	// distance computations
+	ocr::FNearestNeighbor *fnn_euclidean =
+		new ocr::FNearestNeighbor(new ocr::FPNorm(2));
+	fnn_euclidean->set_num_threads(0);
+	fnn_euclidean->train(arma::conv_to<arma::fmat>::from(mnist_train_images_reduced),
+		mnist_train_labels);
+	std::cout << "Single Precision\t\t" << std::flush;
+	timer.start();
+	double error_rate_float = fnn_euclidean->validate(
+		arma::conv_to<arma::fmat>::from(mnist_test_images_reduced), mnist_test_labels);
+	std::cout << timer.elapsed_ms().count() << "\t\t" << error_rate_float
+		<< std::endl;
+
+	// Compare the quantized classifiers to their double counterparts. The
+	// int8 classifier scans the projections; the uint8 classifier scans the
+	// raw pixels of the first queries, which are exact in a byte
+	std::cout << std::endl;
+	std::cout << "Quantization" << "\t\t\t" << "Testing (ms)" << "\t" << "Agreement" << std::endl;
+	arma::Col<ocr::label_t> double_labels;
+	arma::Col<ocr::label_t> quantized_labels;
+	nn_euclidean->validate(mnist_test_images_reduced, mnist_test_labels,
+		&double_labels);
+	std::cout << "Euclidean int8 (PCA)\t\t" << std::flush;
+	timer.start();
+	int8_euclidean->validate(mnist_test_images_reduced, mnist_test_labels,
+		&quantized_labels);
+	std::cout << timer.elapsed_ms().count() << "\t\t";
+	std::cout << arma::mean(arma::conv_to<arma::vec>::from(
+		quantized_labels == double_labels)) << std::endl;
+
+	const arma::uword num_raw_queries = 1000;
+	const arma::mat raw_queries = mnist_test_images.cols(0, num_raw_queries-1);
+	const arma::Col<ocr::label_t> raw_labels =
+		mnist_test_labels.rows(0, num_raw_queries-1);
+	arma::mat mnist_train_images = arma::conv_to<arma::mat>::from(mnist_train_pixels);
+	mnist_train_pixels.reset();
+	ocr::NearestNeighbor *nn_manhattan_raw = new ocr::NearestNeighbor(metric_manhattan);
+	ocr::QuantizedNearestNeighbor *uint8_manhattan =
+		new ocr::QuantizedNearestNeighbor(ocr::QuantizedNearestNeighbor::UINT8, 1);
+	nn_manhattan_raw->set_num_threads(0);
+	uint8_manhattan->set_num_threads(0);
+	nn_manhattan_raw->train(mnist_train_images, mnist_train_labels);
+	uint8_manhattan->train(mnist_train_images, mnist_train_labels);
+	mnist_train_images.reset();
+
+	std::cout << "Manhattan double (raw)\t\t" << std::flush;
+	timer.start();
+	nn_manhattan_raw->validate(raw_queries, raw_labels, &double_labels);
+	std::cout << timer.elapsed_ms().count() << std::endl;
+	std::cout << "Manhattan uint8 (raw)\t\t" << std::flush;
+	timer.start();
+	uint8_manhattan->validate(raw_queries, raw_labels, &quantized_labels);
+	std::cout << timer.elapsed_ms().count() << "\t\t";
+	std::cout << arma::mean(arma::conv_to<arma::vec>::from(
+		quantized_labels == double_labels)) << std::endl;
+
+	std::cout << std::endl;
+	std::cout << "VP Tree skipped distance evaluations per query: "
+			  << vp_manhattan->get_mean_skipped() << " of "
+			  << mnist_train_images_reduced.n_cols << std::endl;
+	std::cout << "Early abandon dimensions touched per candidate: "
+			  << 100*nn_manhattan_abandon->get_touched_fraction() << "%" << std::endl;
+
+	// Sweep the HNSW search width to trade recall against latency. Recall is
+	// the fraction of queries whose exact nearest neighbor is found, and the
+	// agreement is the fraction of labels matching the exact classifier.
+	arma::Col<ocr::label_t> exact_labels;
+	nn_euclidean->validate(mnist_test_images_reduced, mnist_test_labels,
+		&exact_labels);
+	arma::uvec exact_indices = arma::uvec(mnist_test_images_reduced.n_cols);
+	for ( arma::uword i = 0; i < mnist_test_images_reduced.n_cols; i++ ) {
+		exact_indices[i] = kd_euclidean->nearest_neighbors(
+			mnist_test_images_reduced.col(i))[0].index;
+	}
+
+	std::cout << std::endl;
+	std::cout << "HNSW Search Width" << "\t" << "Testing (ms)" << "\t" << "Recall" << "\t\t" << "Agreement" << std::endl;
+	for ( uint32_t ef_search : {10, 20, 40, 80, 160} ) {
+		hnsw_euclidean->set_ef_search(ef_search);
+		std::cout << ef_search << "\t\t\t" << std::flush;
+
+		arma::Col<ocr::label_t> approximate_labels;
+		timer.start();
+		hnsw_euclidean->validate(mnist_test_images_reduced, mnist_test_labels,
+			&approximate_labels);
+		std::cout << timer.elapsed_ms().count() << "\t\t" << std::flush;
+
+		size_t found = 0;
+		for ( arma::uword i = 0; i < mnist_test_images_reduced.n_cols; i++ ) {
+			found += ( hnsw_euclidean->nearest_neighbors(
+				mnist_test_images_reduced.col(i))[0].index == exact_indices[i] );
+		}
+		std::cout << 1.0*found/exact_indices.n_elem << "\t\t";
+		std::cout << arma::mean(arma::conv_to<arma::vec>::from(
+			approximate_labels == exact_labels)) << std::endl;
+	}
 }
\ No newline at end of file
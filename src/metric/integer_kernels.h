@@ -0,0 +1,135 @@
+#ifndef OCR_METRIC_INTEGER_KERNELS_H_
+#define OCR_METRIC_INTEGER_KERNELS_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace ocr {
+	namespace kernels {
+
+#if defined(__SSE2__)
+		/**
+		 * Sum of the four 32-bit lanes of an SSE register
+		 */
+		inline int32_t sum_epi32(__m128i v) {
+			v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+			v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+			return _mm_cvtsi128_si32(v);
+		}
+#endif
+
+		/**
+		 * Manhattan distance between two vectors of unsigned bytes
+		 *
+		 * Uses the sum of absolute differences instruction (psadbw), which
+		 * reduces 16 byte differences per instruction.
+		 *
+		 * @param[in] x pointer to the first vector
+		 * @param[in] y pointer to the second vector
+		 * @param[in] n number of elements
+		 *
+		 * @return \f$ \Sigma_{i=1}^{n} | x_i - y_i | \f$
+		 */
+		inline uint32_t manhattan_u8(const uint8_t *x, const uint8_t *y, size_t n) {
+			uint32_t total = 0;
+			size_t i = 0;
+#if defined(__SSE2__)
+			__m128i acc = _mm_setzero_si128();
+			for ( ; i + 16 <= n; i += 16 ) {
+				acc = _mm_add_epi64(acc, _mm_sad_epu8(
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(x+i)),
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(y+i))));
+			}
+			total = sum_epi32(acc);
+#endif
+			for ( ; i < n; i++ ) {
+				total += abs(int32_t(x[i]) - int32_t(y[i]));
+			}
+			return total;
+		}
+
+		/**
+		 * Squared Euclidean distance between two vectors of unsigned bytes
+		 *
+		 * Widens the bytes to 16 bits and squares and pairwise adds their
+		 * differences with pmaddwd. The 32-bit lanes hold the exact sum for
+		 * vectors of up to about 2^15 elements.
+		 *
+		 * @param[in] x pointer to the first vector
+		 * @param[in] y pointer to the second vector
+		 * @param[in] n number of elements
+		 *
+		 * @return \f$ \Sigma_{i=1}^{n} ( x_i - y_i )^2 \f$
+		 */
+		inline uint32_t squared_euclidean_u8(const uint8_t *x, const uint8_t *y,
+				size_t n) {
+			uint32_t total = 0;
+			size_t i = 0;
+#if defined(__SSE2__)
+			const __m128i zero = _mm_setzero_si128();
+			__m128i acc = _mm_setzero_si128();
+			for ( ; i + 16 <= n; i += 16 ) {
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x+i));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y+i));
+				__m128i low = _mm_sub_epi16(_mm_unpacklo_epi8(a, zero),
+					_mm_unpacklo_epi8(b, zero));
+				__m128i high = _mm_sub_epi16(_mm_unpackhi_epi8(a, zero),
+					_mm_unpackhi_epi8(b, zero));
+				acc = _mm_add_epi32(acc, _mm_madd_epi16(low, low));
+				acc = _mm_add_epi32(acc, _mm_madd_epi16(high, high));
+			}
+			total = sum_epi32(acc);
+#endif
+			for ( ; i < n; i++ ) {
+				int32_t d = int32_t(x[i]) - int32_t(y[i]);
+				total += d*d;
+			}
+			return total;
+		}
+
+		/**
+		 * Inner product of two vectors of signed bytes
+		 *
+		 * Sign-extends the bytes to 16 bits and multiplies and pairwise adds
+		 * them with pmaddwd, which only requires SSE2 (pmaddubsw would need
+		 * SSSE3 and one unsigned operand).
+		 *
+		 * @param[in] x pointer to the first vector
+		 * @param[in] y pointer to the second vector
+		 * @param[in] n number of elements
+		 *
+		 * @return \f$ \Sigma_{i=1}^{n} x_i y_i \f$
+		 */
+		inline int32_t dot_i8(const int8_t *x, const int8_t *y, size_t n) {
+			int32_t total = 0;
+			size_t i = 0;
+#if defined(__SSE2__)
+			__m128i acc = _mm_setzero_si128();
+			for ( ; i + 16 <= n; i += 16 ) {
+				__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x+i));
+				__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y+i));
+				// Each byte is paired with itself and shifted back down, which
+				// leaves it sign-extended in a 16-bit lane
+				acc = _mm_add_epi32(acc, _mm_madd_epi16(
+					_mm_srai_epi16(_mm_unpacklo_epi8(a, a), 8),
+					_mm_srai_epi16(_mm_unpacklo_epi8(b, b), 8)));
+				acc = _mm_add_epi32(acc, _mm_madd_epi16(
+					_mm_srai_epi16(_mm_unpackhi_epi8(a, a), 8),
+					_mm_srai_epi16(_mm_unpackhi_epi8(b, b), 8)));
+			}
+			total = sum_epi32(acc);
+#endif
+			for ( ; i < n; i++ ) {
+				total += int32_t(x[i])*int32_t(y[i]);
+			}
+			return total;
+		}
+
+	}
+}
+
+#endif // OCR_METRIC_INTEGER_KERNELS_H_
@@ -10,9 +10,11 @@ namespace ocr {
  *
  * Specifies the core methods required for defining a vector metric space. This
  * includes a distance function acting on two vectors. This is to make the
- * other component more generalizable.
+ * other component more generalizable. The metric is templated on the element
+ * type of the vectors; Metric acts on doubles and FMetric on floats.
  */
-class Metric {
+template<typename eT>
+class BasicMetric {
 protected:
 	/**
 	 * Base constructor for Metric
@@ -20,10 +22,10 @@ protected:
 	 * The empty constructor for Metric is defined as protected to ensure that
 	 * no developer (me) unwittingly attempts to use it to to create an object.
 	 */
-	Metric() {}
+	BasicMetric() {}
 
 public:
-	virtual ~Metric() {}
+	virtual ~BasicMetric() {}
 
 	/**
 	 * Compute distance between two column vectors
@@ -34,12 +36,33 @@ public:
 	 * @param[in] vec1 armadillo vector
 	 * @param[in] vec2 armadillo vector
 	 *
-	 * @return double distance between input vectors
+	 * @return distance between input vectors
 	 */
-	virtual double distance(const arma::vec &vec1, const arma::vec &vec2) = 0;
+	virtual eT distance(const arma::Col<eT> &vec1, const arma::Col<eT> &vec2) = 0;
+
+	/**
+	 * Compute a value that orders pairs of vectors by their distance
+	 *
+	 * Returns a monotonically increasing function of the distance between
+	 * the vectors, which is all that is required to find the nearest of
+	 * several candidates. Metrics may override this to skip the final,
+	 * costly part of the computation (e.g. the root of a p-norm). Defaults to
+	 * the distance itself.
+	 *
+	 * @param[in] vec1 armadillo vector
+	 * @param[in] vec2 armadillo vector
+	 *
+	 * @return value increasing with the distance between the vectors
+	 */
+	virtual eT rank_distance(const arma::Col<eT> &vec1, const arma::Col<eT> &vec2) {
+		return distance(vec1, vec2);
+	}
 
 };
 
+typedef BasicMetric<double> Metric;
+typedef BasicMetric<float> FMetric;
+
 }
 
 #endif // OCR_METRIC_METRIC_H_
\ No newline at end of file
@@ -0,0 +1,183 @@
+#ifndef OCR_METRIC_PNORM_KERNELS_H_
+#define OCR_METRIC_PNORM_KERNELS_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <cmath>
+
+// Width in bytes of the vector registers targeted by the kernels
+#if defined(__AVX__)
+#define OCR_SIMD_BYTES 32
+#else
+#define OCR_SIMD_BYTES 16
+#endif
+
+namespace ocr {
+	namespace kernels {
+
+		/**
+		 * SIMD vector type for an element type
+		 *
+		 * Uses the compiler vector extensions to define a vector of elements
+		 * that fills a single AVX or SSE register, depending on the target
+		 * architecture.
+		 */
+		template<typename eT>
+		struct Simd {
+			typedef eT Vector __attribute__((vector_size(OCR_SIMD_BYTES)));
+			static const size_t kWidth = sizeof(Vector)/sizeof(eT);
+
+			static inline Vector load(const eT *data) {
+				Vector v;
+				memcpy(&v, data, sizeof(Vector));
+				return v;
+			}
+
+			static inline Vector abs(const Vector &v) {
+				return v < 0 ? -v : v;
+			}
+
+			static inline eT sum(const Vector &v) {
+				eT total = 0;
+				for ( size_t k = 0; k < kWidth; k++ ) {
+					total += v[k];
+				}
+				return total;
+			}
+		};
+
+		/**
+		 * Integer power of a scalar or SIMD vector
+		 *
+		 * Computes v^p by repeated squaring so that a general p-norm never has
+		 * to call pow on the individual elements.
+		 */
+		template<typename T>
+		inline T power(T v, uint32_t p) {
+			T result = T() + 1;
+			while ( p > 0 ) {
+				if ( p & 1 ) {
+					result *= v;
+				}
+				v *= v;
+				p >>= 1;
+			}
+			return result;
+		}
+
+		/**
+		 * Kernels computing the p-th power of the p-norm of a difference
+		 *
+		 * Each specialization provides rank, which returns the sum
+		 * \f$ \Sigma_{i=1}^{n} | x_i - y_i |^p \f$ without forming the
+		 * difference vector, and finish, which maps that sum onto the actual
+		 * distance. As finish is monotone, the result of rank is enough to
+		 * order candidates by distance. The general template, instantiated with
+		 * P = 0, handles any p given at runtime; P = 1 and P = 2 are
+		 * specialized at compile time.
+		 */
+		template<typename eT, uint32_t P>
+		struct PNormKernel {
+			static eT rank(const eT *x, const eT *y, size_t n, uint32_t p) {
+				typedef Simd<eT> S;
+				typename S::Vector acc = typename S::Vector();
+				size_t i = 0;
+				for ( ; i + S::kWidth <= n; i += S::kWidth ) {
+					acc += power(S::abs(S::load(x+i) - S::load(y+i)), p);
+				}
+				eT total = S::sum(acc);
+				for ( ; i < n; i++ ) {
+					total += power(std::abs(x[i] - y[i]), p);
+				}
+				return total;
+			}
+
+			static eT finish(eT rank, uint32_t p) {
+				return std::pow(rank, eT(1)/p);
+			}
+		};
+
+		template<typename eT>
+		struct PNormKernel<eT, 1> {
+			static eT rank(const eT *x, const eT *y, size_t n, uint32_t) {
+				typedef Simd<eT> S;
+				typename S::Vector acc = typename S::Vector();
+				size_t i = 0;
+				for ( ; i + S::kWidth <= n; i += S::kWidth ) {
+					acc += S::abs(S::load(x+i) - S::load(y+i));
+				}
+				eT total = S::sum(acc);
+				for ( ; i < n; i++ ) {
+					total += std::abs(x[i] - y[i]);
+				}
+				return total;
+			}
+
+			static eT finish(eT rank, uint32_t) {
+				return rank;
+			}
+		};
+
+		template<typename eT>
+		struct PNormKernel<eT, 2> {
+			static eT rank(const eT *x, const eT *y, size_t n, uint32_t) {
+				typedef Simd<eT> S;
+				typename S::Vector acc = typename S::Vector();
+				size_t i = 0;
+				for ( ; i + S::kWidth <= n; i += S::kWidth ) {
+					typename S::Vector d = S::load(x+i) - S::load(y+i);
+					acc += d*d;
+				}
+				eT total = S::sum(acc);
+				for ( ; i < n; i++ ) {
+					eT d = x[i] - y[i];
+					total += d*d;
+				}
+				return total;
+			}
+
+			static eT finish(eT rank, uint32_t) {
+				return std::sqrt(rank);
+			}
+		};
+
+		/**
+		 * Partial p-norm kernel abandoning hopeless candidates
+		 *
+		 * Accumulates the same sum as PNormKernel<eT, P>::rank in blocks of
+		 * dimensions and stops as soon as the partial sum exceeds bound. As
+		 * every term is non-negative, a candidate that is abandoned can never
+		 * end up within the bound.
+		 *
+		 * @param[in] x pointer to the first vector
+		 * @param[in] y pointer to the second vector
+		 * @param[in] n number of elements
+		 * @param[in] p p of the p-norm
+		 * @param[in] bound value above which the sum is abandoned
+		 * @param[out] touched number of dimensions accumulated
+		 *
+		 * @return the full sum, or a partial sum greater than bound
+		 */
+		template<typename eT, uint32_t P>
+		inline eT partial_rank(const eT *x, const eT *y, size_t n, uint32_t p,
+				eT bound, size_t &touched) {
+			const size_t kBlock = 4*Simd<eT>::kWidth;
+			eT total = 0;
+			size_t i = 0;
+			for ( ; i + kBlock < n; i += kBlock ) {
+				total += PNormKernel<eT, P>::rank(x+i, y+i, kBlock, p);
+				if ( total > bound ) {
+					touched = i + kBlock;
+					return total;
+				}
+			}
+			total += PNormKernel<eT, P>::rank(x+i, y+i, n-i, p);
+			touched = n;
+			return total;
+		}
+
+	}
+}
+
+#endif // OCR_METRIC_PNORM_KERNELS_H_
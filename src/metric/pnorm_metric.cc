@@ -1,14 +1,59 @@
 #include "metric/pnorm_metric.h"
 
-ocr::PNorm::PNorm(uint32_t p_value) {
+template<typename eT>
+ocr::BasicPNorm<eT>::BasicPNorm(uint32_t p_value) {
 	if ( p_value == 0 ) {
 		throw std::invalid_argument("p_value must be positive");
 	}
 
 	this->p_value_ = p_value;
+
+	switch ( p_value ) {
+		case 1:
+			this->rank_kernel_ = &ocr::kernels::PNormKernel<eT, 1>::rank;
+			this->finish_kernel_ = &ocr::kernels::PNormKernel<eT, 1>::finish;
+			this->partial_kernel_ = &ocr::kernels::partial_rank<eT, 1>;
+			break;
+		case 2:
+			this->rank_kernel_ = &ocr::kernels::PNormKernel<eT, 2>::rank;
+			this->finish_kernel_ = &ocr::kernels::PNormKernel<eT, 2>::finish;
+			this->partial_kernel_ = &ocr::kernels::partial_rank<eT, 2>;
+			break;
+		default:
+			this->rank_kernel_ = &ocr::kernels::PNormKernel<eT, 0>::rank;
+			this->finish_kernel_ = &ocr::kernels::PNormKernel<eT, 0>::finish;
+			this->partial_kernel_ = &ocr::kernels::partial_rank<eT, 0>;
+			break;
+	}
+}
+
+template<typename eT>
+eT ocr::BasicPNorm<eT>::distance(const arma::Col<eT> &vec1,
+	const arma::Col<eT> &vec2)
+{
+	return this->finish_kernel_(rank_distance(vec1, vec2), this->p_value_);
+}
+
+template<typename eT>
+eT ocr::BasicPNorm<eT>::rank_distance(const arma::Col<eT> &vec1,
+	const arma::Col<eT> &vec2)
+{
+	return this->rank_kernel_(vec1.memptr(), vec2.memptr(), vec1.n_elem,
+		this->p_value_);
 }
 
-inline double ocr::PNorm::distance(const arma::vec &vec1, const arma::vec &vec2)
+template<typename eT>
+eT ocr::BasicPNorm<eT>::partial_rank_distance(const arma::Col<eT> &vec1,
+	const arma::Col<eT> &vec2, eT bound, size_t &touched)
 {
-	return arma::norm(vec1 - vec2, this->p_value_);
-}
\ No newline at end of file
+	return this->partial_kernel_(vec1.memptr(), vec2.memptr(), vec1.n_elem,
+		this->p_value_, bound, touched);
+}
+
+template<typename eT>
+uint32_t ocr::BasicPNorm<eT>::get_p_value() const {
+	return this->p_value_;
+}
+
+template class ocr::BasicPNorm<double>;
+template class ocr::BasicPNorm<float>;
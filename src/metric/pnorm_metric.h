@@ -2,6 +2,7 @@
 #define OCR_METRIC_PNORM_H_
 
 #include "metric/metric.h"
+#include "metric/pnorm_kernels.h"
 
 namespace ocr {
 
@@ -14,8 +15,11 @@ namespace ocr {
  * \f[
  * d(x,y) = \left( \Sigma_{i=1}^{n} | x_i |^p \right)^{\frac{1}{p}}
  * \f]
+ * PNorm acts on doubles and FPNorm on floats, whose kernels process twice as
+ * many elements per SIMD register.
  */
-class PNorm : public Metric {
+template<typename eT>
+class BasicPNorm : public BasicMetric<eT> {
 public:
 	/**
 	 * Constructor for p-norm metric
@@ -25,27 +29,78 @@ public:
 	 *
 	 * @param[in] p_value integer greater than 1 specifying norm
 	 */
-	PNorm(uint32_t p_value = 2);
+	BasicPNorm(uint32_t p_value = 2);
 
 	/**
 	 * Compute distance between two column vectors
 	 *
-	 * Use armadillo norm function to calculate the distance between column
-	 * vectors. The norm used is specified in the constructor. Assumes same
+	 * Calculates the distance between column vectors with the kernel selected
+	 * for p in the constructor, without allocating a difference vector. The
+	 * 1- and 2-norms use kernels specialized at compile time. Assumes same
 	 * size between vectors.
 	 *
 	 * @param[in] vec1 armadillo vector
 	 * @param[in] vec2 armadillo vector
 	 *
-	 * @return double distance between input vectors
+	 * @return distance between input vectors
 	 */
-	double distance(const arma::vec &vec1, const arma::vec &vec2);
+	eT distance(const arma::Col<eT> &vec1, const arma::Col<eT> &vec2);
+
+	/**
+	 * Compute the p-th power of the distance between two column vectors
+	 *
+	 * Returns \f$ \Sigma_{i=1}^{n} | x_i - y_i |^p \f$, which orders
+	 * candidates identically to the distance but skips the final root (e.g.
+	 * the squared Euclidean distance). Assumes same size between vectors.
+	 *
+	 * @param[in] vec1 armadillo vector
+	 * @param[in] vec2 armadillo vector
+	 *
+	 * @return p-th power of the distance between input vectors
+	 */
+	eT rank_distance(const arma::Col<eT> &vec1, const arma::Col<eT> &vec2);
+
+	/**
+	 * Compute the p-th power of the distance unless it exceeds a bound
+	 *
+	 * Accumulates the same value as rank_distance block by block and stops
+	 * as soon as the partial sum exceeds bound, which lets a nearest neighbor
+	 * scan reject most candidates after a fraction of their dimensions.
+	 *
+	 * @param[in] vec1 armadillo vector
+	 * @param[in] vec2 armadillo vector
+	 * @param[in] bound value above which the computation is abandoned
+	 * @param[out] touched number of dimensions accumulated
+	 *
+	 * @return rank_distance of the vectors, or a partial sum greater than
+	 *   bound
+	 */
+	eT partial_rank_distance(const arma::Col<eT> &vec1, const arma::Col<eT> &vec2,
+							 eT bound, size_t &touched);
+
+	/**
+	 * Returns the p specifying the norm
+	 *
+	 * @return p value of the p-norm
+	 */
+	uint32_t get_p_value() const;
 
 private:
+	typedef eT (*RankKernel)(const eT*, const eT*, size_t, uint32_t);
+	typedef eT (*FinishKernel)(eT, uint32_t);
+	typedef eT (*PartialKernel)(const eT*, const eT*, size_t, uint32_t, eT,
+								size_t&);
+
 	uint32_t p_value_;
+	RankKernel rank_kernel_; /// Sum of p-th powers for the selected p
+	FinishKernel finish_kernel_; /// Maps the rank value onto the distance
+	PartialKernel partial_kernel_; /// Rank value abandoned above a bound
 
 };
 
+typedef BasicPNorm<double> PNorm;
+typedef BasicPNorm<float> FPNorm;
+
 }
 
 #endif // OCR_METRIC_PNORM_H_
\ No newline at end of file
@@ -0,0 +1,308 @@
+#include "parser/dataset_cache.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+
+#include <zlib.h>
+
+const uint32_t ocr::DatasetCache::kVersion;
+const size_t ocr::DatasetCache::kAlignment;
+
+namespace {
+
+const char kMagic[8] = {'O', 'C', 'R', 'C', 'A', 'C', 'H', 'E'};
+
+/**
+ * Layout of the header at the start of a cache file
+ */
+struct FileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t num_records;
+	uint64_t key;
+	uint32_t checksum;
+	uint32_t reserved;
+	uint64_t size;
+	uint8_t padding[24];
+};
+
+/**
+ * Layout of the record describing each matrix
+ */
+struct FileRecord {
+	char name[32];
+	uint32_t type;
+	uint32_t reserved;
+	uint64_t n_rows;
+	uint64_t n_cols;
+	uint64_t offset;
+};
+
+static_assert(sizeof(FileHeader) == 64, "cache header must be 64 bytes");
+static_assert(sizeof(FileRecord) == 64, "cache record must be 64 bytes");
+
+size_t type_size( uint32_t type ) {
+	switch ( type ) {
+		case ocr::cache::TypeCode<uint8_t>::value: return sizeof(uint8_t);
+		case ocr::cache::TypeCode<uint32_t>::value: return sizeof(uint32_t);
+		case ocr::cache::TypeCode<float>::value: return sizeof(float);
+		case ocr::cache::TypeCode<double>::value: return sizeof(double);
+		default: return 0;
+	}
+}
+
+/**
+ * Returns true if the header opens a cache of this version
+ */
+bool valid_header( const FileHeader &header ) {
+	return memcmp(header.magic, kMagic, sizeof(kMagic)) == 0
+		&& header.version == ocr::DatasetCache::kVersion
+		&& header.size >= sizeof(FileHeader);
+}
+
+size_t align( size_t offset ) {
+	const size_t alignment = ocr::DatasetCache::kAlignment;
+	return ( offset + alignment - 1 ) / alignment * alignment;
+}
+
+/**
+ * Update a CRC-32 with bytes, in chunks that fit the length type of zlib
+ */
+uLong crc32_bytes( uLong crc, const uint8_t *data, size_t size ) {
+	for ( size_t offset = 0; offset < size; offset += UINT_MAX ) {
+		crc = crc32(crc, data + offset, std::min<size_t>(size - offset, UINT_MAX));
+	}
+	return crc;
+}
+
+/**
+ * Mix bytes into a 64-bit FNV-1a hash
+ */
+uint64_t fnv1a( uint64_t hash, const void *data, size_t size ) {
+	const uint8_t *bytes = static_cast<const uint8_t*>(data);
+	for ( size_t i = 0; i < size; i++ ) {
+		hash = ( hash ^ bytes[i] ) * 1099511628211ull;
+	}
+	return hash;
+}
+
+}
+
+ocr::DatasetCache::DatasetCache( const std::string &filename ) : file_(filename) {
+	this->data_ = this->file_.data();
+	this->size_ = this->file_.is_open() ? this->file_.size() : 0;
+	parse();
+}
+
+ocr::DatasetCache::DatasetCache( std::istream &stream ) : file_("") {
+	// Only the bytes of this cache are read, so that whatever follows it
+	// in the stream is left there. The size comes from the stream, so the
+	// buffer grows in chunks as the bytes arrive rather than all at once.
+	const size_t kChunkSize = 1 << 20;
+	FileHeader header;
+	this->buffer_.resize(sizeof(header));
+	stream.read(reinterpret_cast<char*>(this->buffer_.data()), sizeof(header));
+	this->buffer_.resize(stream.gcount());
+
+	if ( this->buffer_.size() == sizeof(header) ) {
+		memcpy(&header, this->buffer_.data(), sizeof(header));
+		size_t position = sizeof(header);
+		while ( valid_header(header) && position < header.size && stream ) {
+			const size_t chunk = std::min<uint64_t>(header.size - position, kChunkSize);
+			this->buffer_.resize(position + chunk);
+			stream.read(reinterpret_cast<char*>(this->buffer_.data() + position),
+				chunk);
+			position += stream.gcount();
+		}
+		this->buffer_.resize(position);
+	}
+
+	this->data_ = this->buffer_.data();
+	this->size_ = this->buffer_.size();
+	parse();
+}
+
+void ocr::DatasetCache::parse() {
+	this->valid_ = false;
+	this->key_ = 0;
+	this->checksum_ = 0;
+
+	const uint8_t *bytes = this->data_;
+	if ( this->size_ < sizeof(FileHeader) ) {
+		return;
+	}
+
+	FileHeader header;
+	memcpy(&header, bytes, sizeof(header));
+	if ( !valid_header(header) || header.size > this->size_ ) {
+		return;
+	}
+
+	// Anything past the end of the cache is not part of it
+	const size_t size = this->size_ = header.size;
+	if ( header.num_records > (size - sizeof(FileHeader))/sizeof(FileRecord) ) {
+		return;
+	}
+
+	for ( uint32_t r = 0; r < header.num_records; r++ ) {
+		FileRecord file_record;
+		memcpy(&file_record, bytes + sizeof(FileHeader) + r*sizeof(FileRecord),
+			sizeof(file_record));
+
+		// The sizes come from the file, so the elements are counted by
+		// division against the space left, which cannot overflow
+		const size_t element_size = type_size(file_record.type);
+		if ( element_size == 0 || file_record.offset % kAlignment != 0
+			|| file_record.offset > size
+			|| ( file_record.n_rows != 0 && file_record.n_cols >
+				(size - file_record.offset)/element_size/file_record.n_rows ) ) {
+			this->records_.clear();
+			return;
+		}
+
+		Record record;
+		record.name = std::string(file_record.name,
+			strnlen(file_record.name, sizeof(file_record.name)));
+		record.type = file_record.type;
+		record.n_rows = file_record.n_rows;
+		record.n_cols = file_record.n_cols;
+		record.offset = file_record.offset;
+		this->records_.push_back(record);
+	}
+
+	this->key_ = header.key;
+	this->checksum_ = header.checksum;
+	this->valid_ = true;
+}
+
+bool ocr::DatasetCache::is_open() const {
+	return this->valid_;
+}
+
+uint64_t ocr::DatasetCache::get_key() const {
+	return this->key_;
+}
+
+bool ocr::DatasetCache::verify() const {
+	if ( !this->valid_ ) {
+		return false;
+	}
+	uLong crc = crc32_bytes(crc32(0L, Z_NULL, 0),
+		this->data_ + sizeof(FileHeader), this->size_ - sizeof(FileHeader));
+	return crc == this->checksum_;
+}
+
+bool ocr::DatasetCache::contains( const std::string &name ) const {
+	for ( const Record &record : this->records_ ) {
+		if ( record.name == name ) {
+			return true;
+		}
+	}
+	return false;
+}
+
+const ocr::DatasetCache::Record* ocr::DatasetCache::find(
+	const std::string &name, uint32_t type ) const {
+	for ( const Record &record : this->records_ ) {
+		if ( record.name == name && record.type == type ) {
+			return &record;
+		}
+	}
+	return nullptr;
+}
+
+uint64_t ocr::DatasetCache::hash( const std::vector<std::string> &filenames,
+	const std::string &parameters ) {
+	uint64_t hash = 14695981039346656037ull;
+
+	for ( const std::string &filename : filenames ) {
+		ocr::utilities::MappedFile file(filename);
+		uint64_t size = file.size();
+		uLong crc = crc32_bytes(crc32(0L, Z_NULL, 0), file.data(), file.size());
+
+		// A missing file hashes as an empty file with an all-ones size
+		if ( !file.is_open() ) {
+			size = ~0ull;
+		}
+		hash = fnv1a(hash, &size, sizeof(size));
+		hash = fnv1a(hash, &crc, sizeof(crc));
+	}
+
+	return fnv1a(hash, parameters.data(), parameters.size());
+}
+
+bool ocr::DatasetCacheWriter::write( const std::string &filename,
+	uint64_t key ) const {
+	const std::string temporary = filename + ".tmp";
+	std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+	write(file, key);
+	file.close();
+
+	if ( !file ) {
+		std::remove(temporary.c_str());
+		return false;
+	}
+	return std::rename(temporary.c_str(), filename.c_str()) == 0;
+}
+
+bool ocr::DatasetCacheWriter::write( std::ostream &stream, uint64_t key ) const {
+	FileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, kMagic, sizeof(kMagic));
+	header.version = ocr::DatasetCache::kVersion;
+	header.num_records = this->entries_.size();
+	header.key = key;
+
+	std::vector<FileRecord> records(this->entries_.size());
+	size_t offset = align(sizeof(FileHeader) + records.size()*sizeof(FileRecord));
+	for ( size_t r = 0; r < records.size(); r++ ) {
+		const Entry &entry = this->entries_[r];
+		if ( entry.name.size() >= sizeof(records[r].name) ) {
+			throw std::invalid_argument("cache matrix name is too long");
+		}
+
+		memset(&records[r], 0, sizeof(records[r]));
+		memcpy(records[r].name, entry.name.data(), entry.name.size());
+		records[r].type = entry.type;
+		records[r].n_rows = entry.n_rows;
+		records[r].n_cols = entry.n_cols;
+		records[r].offset = offset;
+		header.size = offset + entry.bytes;
+		offset = align(header.size);
+	}
+	if ( records.empty() ) {
+		header.size = sizeof(FileHeader);
+	}
+
+	// The body following the header is produced twice: once for its
+	// checksum, which the header holds, and once to write it
+	const char padding[ocr::DatasetCache::kAlignment] = {0};
+	auto body = [&](const std::function<void(const char*, size_t)> &emit) {
+		emit(reinterpret_cast<const char*>(records.data()),
+			records.size()*sizeof(FileRecord));
+		size_t position = sizeof(FileHeader) + records.size()*sizeof(FileRecord);
+		for ( size_t r = 0; r < records.size(); r++ ) {
+			emit(padding, records[r].offset - position);
+			emit(static_cast<const char*>(this->entries_[r].data),
+				this->entries_[r].bytes);
+			position = records[r].offset + this->entries_[r].bytes;
+		}
+	};
+
+	uLong crc = crc32(0L, Z_NULL, 0);
+	body([&](const char *data, size_t size) {
+		crc = crc32_bytes(crc, reinterpret_cast<const uint8_t*>(data), size);
+	});
+	header.checksum = crc;
+
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	body([&](const char *data, size_t size) {
+		stream.write(data, size);
+	});
+	return static_cast<bool>(stream);
+}
@@ -0,0 +1,239 @@
+#ifndef OCR_PARSER_DATASET_CACHE_H_
+#define OCR_PARSER_DATASET_CACHE_H_
+
+#include <stdint.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <armadillo>
+
+#include "util/mapped_file.h"
+
+namespace ocr {
+
+namespace cache {
+
+/**
+ * Maps an element type to its code in a cache file
+ */
+template<typename eT> struct TypeCode;
+template<> struct TypeCode<uint8_t> { static const uint32_t value = 1; };
+template<> struct TypeCode<uint32_t> { static const uint32_t value = 2; };
+template<> struct TypeCode<float> { static const uint32_t value = 3; };
+template<> struct TypeCode<double> { static const uint32_t value = 4; };
+
+}
+
+/**
+ * A memory-mapped cache of named matrices
+ *
+ * Reads a cache file holding matrices that are expensive to compute from the
+ * source datasets, such as converted images, labels and PCA projections.
+ * The file starts with a 64-byte header (magic number, format version,
+ * number of matrices, a key identifying the inputs, a CRC-32 of the rest
+ * of the cache and the size of the cache), followed by a 64-byte record for each matrix and then the
+ * elements of each matrix in column-major order and host byte order,
+ * starting on a 64-byte boundary. Opening the cache only maps the file, and
+ * each matrix is a view of the mapping, so a cached dataset is available
+ * almost immediately. The checksum is only computed by verify, which reads
+ * the whole file.
+ *
+ * The key is chosen by the writer, typically with DatasetCache::hash over
+ * the source files and the parameters of the computation. A reader compares
+ * it to the key of its own inputs to decide whether the cache is stale.
+ * Serialized models use the same format, with a key naming the model.
+ */
+class DatasetCache {
+public:
+	static const uint32_t kVersion = 3; /// Version of the file format
+	static const size_t kAlignment = 64; /// Alignment of each matrix in bytes
+
+	/**
+	 * Map and validate a cache file
+	 *
+	 * The cache is considered closed (is_open returns false) if the file
+	 * cannot be mapped, is not a cache of this version, or any matrix
+	 * extends past the end of the file.
+	 *
+	 * @param[in] filename name of the cache file
+	 */
+	explicit DatasetCache( const std::string &filename );
+
+	/**
+	 * Read and validate a cache from a stream
+	 *
+	 * Reads the cache into memory, so the matrices are views of a buffer
+	 * owned by the cache rather than of a mapping. The stream is left at the
+	 * end of the cache, so caches written one after another to a stream are
+	 * read back in the same order.
+	 *
+	 * @param[in] stream binary stream positioned at the start of a cache
+	 */
+	explicit DatasetCache( std::istream &stream );
+	~DatasetCache() {}
+
+	/**
+	 * Returns true if the file is a valid cache
+	 */
+	bool is_open() const;
+
+	/**
+	 * Returns the key the cache was written with
+	 */
+	uint64_t get_key() const;
+
+	/**
+	 * Returns true if the checksum of the cache matches its contents
+	 *
+	 * Computes the CRC-32 of everything following the header, which reads
+	 * every page of the file.
+	 */
+	bool verify() const;
+
+	/**
+	 * Returns true if the cache holds a matrix with the given name
+	 */
+	bool contains( const std::string &name ) const;
+
+	/**
+	 * View a cached matrix
+	 *
+	 * The matrix uses the mapped memory directly. It must not outlive the
+	 * DatasetCache, and writes to it are never written back to the file.
+	 *
+	 * @param[in] name name of the matrix
+	 *
+	 * @return view of the matrix, or an empty matrix if the cache holds no
+	 *   matrix of that name and element type
+	 */
+	template<typename eT>
+	arma::Mat<eT> get( const std::string &name ) const {
+		const Record *record = find(name, cache::TypeCode<eT>::value);
+		if ( record == nullptr ) {
+			return arma::Mat<eT>();
+		}
+		return arma::Mat<eT>(reinterpret_cast<eT*>(const_cast<uint8_t*>(
+			this->data_) + record->offset), record->n_rows, record->n_cols,
+			false, true);
+	}
+
+	/**
+	 * Compute a key identifying a set of inputs
+	 *
+	 * Hashes the contents of each file (CRC-32) along with its size and the
+	 * parameter string, so that the key changes whenever a file or
+	 * parameter does. A missing file hashes differently from any file.
+	 *
+	 * @param[in] filenames names of the source files
+	 * @param[in] parameters description of the parameters of the computation
+	 *
+	 * @return 64-bit key
+	 */
+	static uint64_t hash( const std::vector<std::string> &filenames,
+						  const std::string &parameters );
+
+private:
+	/**
+	 * Location and shape of a cached matrix
+	 */
+	struct Record {
+		std::string name;
+		uint32_t type;
+		arma::uword n_rows;
+		arma::uword n_cols;
+		size_t offset;
+	};
+
+	/**
+	 * Validate the cache held in data_ and read its records
+	 */
+	void parse();
+
+	/**
+	 * Returns the record of a matrix, or nullptr if there is none
+	 */
+	const Record* find( const std::string &name, uint32_t type ) const;
+
+	utilities::MappedFile file_; /// Mapping of the cache file
+	std::vector<uint8_t> buffer_; /// Contents of a cache read from a stream
+	const uint8_t *data_; /// Start of the cache in file_ or buffer_
+	size_t size_; /// Size of the cache in bytes
+	bool valid_; /// Whether the file is a valid cache
+	uint64_t key_; /// Key the cache was written with
+	uint32_t checksum_; /// CRC-32 of the cache following the header
+	std::vector<Record> records_; /// Cached matrices
+};
+
+/**
+ * Writes a cache file read by DatasetCache
+ *
+ * Matrices are added by reference and written when write is called, so they
+ * must remain alive (and unchanged) until then.
+ */
+class DatasetCacheWriter {
+public:
+	DatasetCacheWriter() {}
+	~DatasetCacheWriter() {}
+
+	/**
+	 * Add a matrix to the cache
+	 *
+	 * @param[in] name name of the matrix (at most 31 characters)
+	 * @param[in] matrix matrix to write
+	 */
+	template<typename eT>
+	void add( const std::string &name, const arma::Mat<eT> &matrix ) {
+		Entry entry;
+		entry.name = name;
+		entry.type = cache::TypeCode<eT>::value;
+		entry.n_rows = matrix.n_rows;
+		entry.n_cols = matrix.n_cols;
+		entry.data = matrix.memptr();
+		entry.bytes = matrix.n_elem*sizeof(eT);
+		this->entries_.push_back(entry);
+	}
+
+	/**
+	 * Write the cache file
+	 *
+	 * Writes to a temporary file that is renamed over filename once it is
+	 * complete, so that a reader never maps a partially written cache.
+	 *
+	 * @param[in] filename name of the cache file
+	 * @param[in] key key identifying the inputs of the cached matrices
+	 *
+	 * @return true if the file was written
+	 */
+	bool write( const std::string &filename, uint64_t key ) const;
+
+	/**
+	 * Write the cache to a stream
+	 *
+	 * @param[in] stream binary output stream
+	 * @param[in] key key identifying the inputs of the cached matrices
+	 *
+	 * @return true if the stream is still good after writing
+	 */
+	bool write( std::ostream &stream, uint64_t key ) const;
+
+private:
+	/**
+	 * A matrix waiting to be written
+	 */
+	struct Entry {
+		std::string name;
+		uint32_t type;
+		arma::uword n_rows;
+		arma::uword n_cols;
+		const void *data;
+		size_t bytes;
+	};
+
+	std::vector<Entry> entries_; /// Matrices to write
+};
+
+}
+
+#endif // OCR_PARSER_DATASET_CACHE_H_
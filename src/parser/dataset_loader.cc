@@ -0,0 +1,21 @@
+#include "parser/dataset_loader.h"
+
+template<typename eT>
+std::future<arma::Mat<eT>> ocr::DatasetLoader::load_images(
+	const std::string &filename ) {
+	return this->pool_.submit([filename]() {
+		return ocr::mnist::parse_images<eT>(filename);
+	});
+}
+
+template std::future<arma::Mat<double>> ocr::DatasetLoader::load_images(
+	const std::string&);
+template std::future<arma::Mat<float>> ocr::DatasetLoader::load_images(
+	const std::string&);
+
+std::future<arma::Col<ocr::label_t>> ocr::DatasetLoader::load_labels(
+	const std::string &filename ) {
+	return this->pool_.submit([filename]() {
+		return ocr::mnist::parse_labels(filename);
+	});
+}
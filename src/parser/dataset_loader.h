@@ -0,0 +1,59 @@
+#ifndef OCR_PARSER_DATASET_LOADER_H_
+#define OCR_PARSER_DATASET_LOADER_H_
+
+#include <future>
+#include <string>
+
+#include <armadillo>
+
+#include "parser/mnist_parser.h"
+#include "util/ocrtypes.h"
+#include "util/thread_pool.h"
+
+namespace ocr {
+
+/**
+ * Loads dataset files concurrently on a small pool of I/O threads
+ *
+ * Each load is queued on the pool and returns immediately with a future, so
+ * several files are read and decoded at the same time and the caller can
+ * start working on a dataset as soon as its own future is ready. The loader
+ * must outlive the futures it returns; destroying it waits for every queued
+ * load to finish.
+ */
+class DatasetLoader {
+public:
+	/**
+	 * Constructor for the dataset loader
+	 *
+	 * @param[in] num_threads number of I/O threads (0 = all cores)
+	 */
+	explicit DatasetLoader( size_t num_threads = 4 ) : pool_(num_threads) {}
+	~DatasetLoader() {}
+
+	/**
+	 * Queue the parsing of an image file
+	 *
+	 * @param[in] filename name of the IDX image file
+	 *
+	 * @return future holding the result of mnist::parse_images<eT>
+	 */
+	template<typename eT = double>
+	std::future<arma::Mat<eT>> load_images( const std::string &filename );
+
+	/**
+	 * Queue the parsing of a label file
+	 *
+	 * @param[in] filename name of the IDX label file
+	 *
+	 * @return future holding the result of mnist::parse_labels
+	 */
+	std::future<arma::Col<label_t>> load_labels( const std::string &filename );
+
+private:
+	utilities::ThreadPool pool_; /// I/O threads
+};
+
+}
+
+#endif // OCR_PARSER_DATASET_LOADER_H_
@@ -0,0 +1,116 @@
+#include "parser/dataset_stream.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+template<typename eT>
+ocr::BasicDatasetStream<eT>::BasicDatasetStream(
+	const std::string &images_filename, const std::string &labels_filename,
+	arma::uword batch_size, bool prefetch )
+	: images_(images_filename), labels_(labels_filename) {
+	if ( batch_size == 0 ) {
+		throw std::invalid_argument("batch size must be at least 1");
+	}
+
+	this->has_labels_ = !labels_filename.empty();
+	this->batch_size_ = batch_size;
+	this->prefetch_ = prefetch;
+	reset();
+}
+
+template<typename eT>
+ocr::BasicDatasetStream<eT>::~BasicDatasetStream() {
+	if ( this->pending_.valid() ) {
+		this->pending_.wait();
+	}
+}
+
+template<typename eT>
+bool ocr::BasicDatasetStream<eT>::is_open() const {
+	if ( !this->images_.is_open() ) {
+		return false;
+	}
+	return !this->has_labels_ || ( this->labels_.is_open()
+		&& this->labels_.num_entries() == this->images_.num_entries() );
+}
+
+template<typename eT>
+bool ocr::BasicDatasetStream<eT>::has_labels() const {
+	return this->has_labels_;
+}
+
+template<typename eT>
+arma::uword ocr::BasicDatasetStream<eT>::num_entries() const {
+	return is_open() ? this->images_.num_entries() : 0;
+}
+
+template<typename eT>
+arma::uword ocr::BasicDatasetStream<eT>::entry_size() const {
+	return this->images_.entry_size();
+}
+
+template<typename eT>
+arma::uword ocr::BasicDatasetStream<eT>::get_batch_size() const {
+	return this->batch_size_;
+}
+
+template<typename eT>
+bool ocr::BasicDatasetStream<eT>::next( arma::Mat<eT> &batch,
+	arma::Col<ocr::label_t> *labels ) {
+	if ( this->position_ >= num_entries() ) {
+		return false;
+	}
+
+	Batch current = this->pending_.valid() ? this->pending_.get()
+		: load(this->position_);
+	if ( current.data.n_cols == 0 ) {
+		// The payload of a compressed file ended early or is corrupt
+		return false;
+	}
+	this->position_ += current.data.n_cols;
+
+	if ( this->prefetch_ && this->position_ < num_entries() ) {
+		this->pending_ = std::async(std::launch::async,
+			&BasicDatasetStream::load, this, this->position_);
+	}
+
+	batch = std::move(current.data);
+	if ( labels != nullptr ) {
+		*labels = std::move(current.labels);
+	}
+	return true;
+}
+
+template<typename eT>
+void ocr::BasicDatasetStream<eT>::reset() {
+	if ( this->pending_.valid() ) {
+		this->pending_.wait();
+		this->pending_ = std::future<Batch>();
+	}
+
+	this->position_ = 0;
+	if ( this->prefetch_ && num_entries() > 0 ) {
+		this->pending_ = std::async(std::launch::async,
+			&BasicDatasetStream::load, this, 0);
+	}
+}
+
+template<typename eT>
+typename ocr::BasicDatasetStream<eT>::Batch ocr::BasicDatasetStream<eT>::load(
+	arma::uword first ) const {
+	const arma::uword count = std::min(this->batch_size_, num_entries() - first);
+
+	Batch batch;
+	batch.data = this->images_.template to_matrix<eT>(first, count);
+	this->images_.release(first, count);
+	if ( this->has_labels_ ) {
+		batch.labels = arma::Col<label_t>(count);
+		if ( !this->labels_.convert(batch.labels.memptr(), first, count) ) {
+			batch.data.reset();
+		}
+	}
+	return batch;
+}
+
+template class ocr::BasicDatasetStream<double>;
+template class ocr::BasicDatasetStream<float>;
@@ -0,0 +1,114 @@
+#ifndef OCR_PARSER_DATASET_STREAM_H_
+#define OCR_PARSER_DATASET_STREAM_H_
+
+#include <future>
+#include <string>
+
+#include <armadillo>
+
+#include "parser/idx_file.h"
+#include "util/ocrtypes.h"
+
+namespace ocr {
+
+/**
+ * A stream of fixed-size batches read from IDX files
+ *
+ * Reads a dataset (and optionally its labels) in batches of columns, so that
+ * datasets larger than memory can be processed with a bounded footprint.
+ * The files are memory-mapped (and inflated as they are read if they are
+ * gzip-compressed), and the pages of each batch are released once it has
+ * been converted. While the caller processes a batch, the next one is
+ * converted on a background thread. The entries are converted to the element
+ * type of the stream; DatasetStream reads doubles and FDatasetStream floats.
+ */
+template<typename eT>
+class BasicDatasetStream {
+public:
+	/**
+	 * Open a stream over a dataset and its labels
+	 *
+	 * @param[in] images_filename IDX file holding an entry in each row of its
+	 *   first dimension
+	 * @param[in] labels_filename IDX file holding a label for each entry, or
+	 *   an empty string for an unlabelled dataset
+	 * @param[in] batch_size maximum number of entries in a batch
+	 * @param[in] prefetch whether to convert the next batch in the background
+	 */
+	BasicDatasetStream( const std::string &images_filename,
+				   const std::string &labels_filename = "",
+				   arma::uword batch_size = 1024, bool prefetch = true );
+	~BasicDatasetStream();
+
+	/**
+	 * Returns true if the files are open and hold the same number of entries
+	 */
+	bool is_open() const;
+
+	/**
+	 * Returns true if the stream was opened with a labels file
+	 */
+	bool has_labels() const;
+
+	/**
+	 * Returns the total number of entries in the dataset
+	 */
+	arma::uword num_entries() const;
+
+	/**
+	 * Returns the number of elements of each entry
+	 */
+	arma::uword entry_size() const;
+
+	/**
+	 * Returns the maximum number of entries in a batch
+	 */
+	arma::uword get_batch_size() const;
+
+	/**
+	 * Read the next batch
+	 *
+	 * @param[out] batch entry_size x b matrix with an entry in each column,
+	 *   where b is at most the batch size
+	 * @param[out] labels b x 1 vector of labels of the batch, if not null
+	 *
+	 * @return false once every entry has been read
+	 */
+	bool next( arma::Mat<eT> &batch, arma::Col<label_t> *labels = nullptr );
+
+	/**
+	 * Rewind the stream to the first entry
+	 */
+	void reset();
+
+private:
+	/**
+	 * A batch of entries and their labels
+	 */
+	struct Batch {
+		arma::Mat<eT> data;
+		arma::Col<label_t> labels;
+	};
+
+	/**
+	 * Convert the batch starting at an entry and release its pages
+	 *
+	 * @param[in] first index of the first entry of the batch
+	 */
+	Batch load( arma::uword first ) const;
+
+	IdxFile images_; /// Mapped dataset
+	IdxFile labels_; /// Mapped labels (not open for an unlabelled dataset)
+	bool has_labels_; /// Whether a labels file was given
+	arma::uword batch_size_; /// Maximum number of entries in a batch
+	bool prefetch_; /// Whether batches are converted in the background
+	arma::uword position_; /// Index of the first entry of the next batch
+	std::future<Batch> pending_; /// Batch being converted in the background
+};
+
+typedef BasicDatasetStream<double> DatasetStream;
+typedef BasicDatasetStream<float> FDatasetStream;
+
+}
+
+#endif // OCR_PARSER_DATASET_STREAM_H_
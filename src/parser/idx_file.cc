@@ -0,0 +1,140 @@
+#include "parser/idx_file.h"
+
+const uint8_t ocr::IdxFile::kUnsignedByte;
+const uint8_t ocr::IdxFile::kSignedByte;
+const uint8_t ocr::IdxFile::kShort;
+const uint8_t ocr::IdxFile::kInt;
+const uint8_t ocr::IdxFile::kFloat;
+const uint8_t ocr::IdxFile::kDouble;
+const size_t ocr::IdxFile::kChunkBytes;
+const size_t ocr::IdxFile::kMaxDeflateRatio;
+
+ocr::IdxFile::IdxFile( const std::string &filename ) : file_(filename) {
+	this->valid_ = false;
+	this->type_ = 0;
+	this->offset_ = 0;
+
+	if ( !this->file_.is_open() ) {
+		return;
+	}
+
+	// The header of a compressed file is inflated into a buffer of its own
+	const uint8_t *bytes = this->file_.data();
+	size_t size = this->file_.size();
+	std::vector<uint8_t> header;
+	if ( ocr::utilities::GzipReader::is_gzip(bytes, size) ) {
+		this->reader_.reset(new ocr::utilities::GzipReader(bytes, size));
+		this->mutex_.reset(new std::mutex());
+		header.resize(4 + 4*UINT8_MAX);
+		size = this->reader_->read(header.data(), 4);
+		if ( size == 4 ) {
+			size += this->reader_->read(header.data() + 4, 4*header[3]);
+		}
+		bytes = header.data();
+	}
+
+	if ( size < 4 || bytes[0] != 0 || bytes[1] != 0 ) {
+		return;
+	}
+
+	this->type_ = bytes[2];
+	const uint8_t num_dimensions = bytes[3];
+	this->offset_ = 4 + 4*num_dimensions;
+	if ( num_dimensions == 0 || size < this->offset_ || element_size() == 0 ) {
+		return;
+	}
+
+	// Dimensions are stored as big-endian 32-bit integers. They come from
+	// the file, so their product is checked before it is formed
+	size_t num_elements = 1;
+	for ( uint8_t d = 0; d < num_dimensions; d++ ) {
+		this->dimensions_.push_back(idx::load<uint32_t>(bytes + 4 + 4*d));
+		const size_t dimension = this->dimensions_.back();
+		if ( dimension != 0 && num_elements > SIZE_MAX/dimension ) {
+			this->dimensions_.clear();
+			return;
+		}
+		num_elements *= dimension;
+	}
+
+	if ( is_compressed() ) {
+		// The trailer only holds the size modulo 2^32, so the size claimed by
+		// the header must also fit in memory and be reachable by inflating
+		// the compressed stream
+		if ( num_elements > (SIZE_MAX - this->offset_)/element_size() ) {
+			return;
+		}
+		const size_t file_size = this->offset_ + num_elements*element_size();
+		this->valid_ = ( this->reader_->trailer_size() == (uint32_t)file_size
+			&& file_size/kMaxDeflateRatio <= this->file_.size() );
+	}
+	else {
+		this->valid_ = ( num_elements <= (size - this->offset_)/element_size() );
+	}
+}
+
+bool ocr::IdxFile::is_open() const {
+	return this->valid_;
+}
+
+uint8_t ocr::IdxFile::get_type() const {
+	return this->type_;
+}
+
+size_t ocr::IdxFile::element_size() const {
+	switch ( this->type_ ) {
+		case kUnsignedByte: return sizeof(uint8_t);
+		case kSignedByte: return sizeof(int8_t);
+		case kShort: return sizeof(int16_t);
+		case kInt: return sizeof(int32_t);
+		case kFloat: return sizeof(float);
+		case kDouble: return sizeof(double);
+		default: return 0;
+	}
+}
+
+const std::vector<uint32_t>& ocr::IdxFile::get_dimensions() const {
+	return this->dimensions_;
+}
+
+arma::uword ocr::IdxFile::num_entries() const {
+	return this->dimensions_.empty() ? 0 : this->dimensions_[0];
+}
+
+arma::uword ocr::IdxFile::entry_size() const {
+	arma::uword size = 1;
+	for ( size_t d = 1; d < this->dimensions_.size(); d++ ) {
+		size *= this->dimensions_[d];
+	}
+	return size;
+}
+
+bool ocr::IdxFile::is_compressed() const {
+	return this->reader_ != nullptr;
+}
+
+const uint8_t* ocr::IdxFile::data() const {
+	if ( is_compressed() ) {
+		return nullptr;
+	}
+	return this->file_.data() + this->offset_;
+}
+
+void ocr::IdxFile::release( arma::uword first, arma::uword count ) const {
+	if ( is_compressed() ) {
+		std::lock_guard<std::mutex> lock(*this->mutex_);
+		this->file_.release(0, this->reader_->consumed());
+		return;
+	}
+
+	const size_t entry_bytes = entry_size()*element_size();
+	this->file_.release(this->offset_ + first*entry_bytes, count*entry_bytes);
+}
+
+arma::Mat<uint8_t> ocr::IdxFile::bytes() const {
+	if ( !is_open() || is_compressed() || this->type_ != kUnsignedByte ) {
+		return arma::Mat<uint8_t>();
+	}
+	return arma::Mat<uint8_t>(this->file_.data() + this->offset_, entry_size(),
+		num_entries(), false, true);
+}
@@ -0,0 +1,326 @@
+#ifndef OCR_PARSER_IDX_FILE_H_
+#define OCR_PARSER_IDX_FILE_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <armadillo>
+
+#include "util/gzip_reader.h"
+#include "util/mapped_file.h"
+
+namespace ocr {
+
+namespace idx {
+
+inline uint8_t byte_swap( uint8_t bits ) { return bits; }
+inline uint16_t byte_swap( uint16_t bits ) { return __builtin_bswap16(bits); }
+inline uint32_t byte_swap( uint32_t bits ) { return __builtin_bswap32(bits); }
+inline uint64_t byte_swap( uint64_t bits ) { return __builtin_bswap64(bits); }
+
+/**
+ * Unsigned integer of the same size as an element type
+ */
+template<size_t N> struct Bits;
+template<> struct Bits<1> { typedef uint8_t type; };
+template<> struct Bits<2> { typedef uint16_t type; };
+template<> struct Bits<4> { typedef uint32_t type; };
+template<> struct Bits<8> { typedef uint64_t type; };
+
+/**
+ * Load a big-endian element
+ *
+ * @param[in] in address of the element (need not be aligned)
+ *
+ * @return element in host byte order
+ */
+template<typename eT>
+inline eT load( const uint8_t *in ) {
+	typename Bits<sizeof(eT)>::type bits;
+	memcpy(&bits, in, sizeof(eT));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	bits = byte_swap(bits);
+#endif
+	eT value;
+	memcpy(&value, &bits, sizeof(eT));
+	return value;
+}
+
+}
+
+/**
+ * A memory-mapped IDX dataset file
+ *
+ * Maps an IDX file (the format of the MNIST datasets) into memory and parses
+ * its header. The first dimension of the file indexes the entries and the
+ * remaining dimensions are flattened into each entry in row-major order, so
+ * that a file of 28x28 images is viewed as a 784xN matrix. Every IDX element
+ * type is supported. Unsigned byte payloads are exposed without any copy,
+ * and other payloads are read into typed matrices on demand for any range of
+ * entries.
+ *
+ * Gzip-compressed files (such as the .gz files MNIST is distributed as) are
+ * detected by their magic number and inflated while they are read, without
+ * any temporary file. Their payload cannot be viewed in place.
+ */
+class IdxFile {
+public:
+	static const uint8_t kUnsignedByte = 0x08; /// Type byte of uint8 data
+	static const uint8_t kSignedByte = 0x09; /// Type byte of int8 data
+	static const uint8_t kShort = 0x0B; /// Type byte of int16 data
+	static const uint8_t kInt = 0x0C; /// Type byte of int32 data
+	static const uint8_t kFloat = 0x0D; /// Type byte of float32 data
+	static const uint8_t kDouble = 0x0E; /// Type byte of float64 data
+
+	static const size_t kChunkBytes = 1 << 20; /// Bytes inflated at a time
+	static const size_t kMaxDeflateRatio = 1032; /// Most bytes per deflated byte
+
+	/**
+	 * Map and parse an IDX file
+	 *
+	 * The file is considered closed (is_open returns false) if it cannot be
+	 * mapped, its header is malformed or names an unknown type, or it is
+	 * shorter than its header specifies. For a compressed file, the length
+	 * is checked against the size recorded in the gzip trailer.
+	 *
+	 * @param[in] filename name of the IDX file
+	 */
+	explicit IdxFile( const std::string &filename );
+	~IdxFile() {}
+
+	/**
+	 * Returns true if the file was mapped and its header is valid
+	 */
+	bool is_open() const;
+
+	/**
+	 * Returns the type byte of the magic number
+	 */
+	uint8_t get_type() const;
+
+	/**
+	 * Returns the size in bytes of a single element
+	 */
+	size_t element_size() const;
+
+	/**
+	 * Returns the size of each dimension, as stored in the header
+	 */
+	const std::vector<uint32_t>& get_dimensions() const;
+
+	/**
+	 * Returns the number of entries (the first dimension)
+	 */
+	arma::uword num_entries() const;
+
+	/**
+	 * Returns the number of elements of each entry
+	 *
+	 * @return product of every dimension but the first
+	 */
+	arma::uword entry_size() const;
+
+	/**
+	 * Returns true if the file is gzip-compressed
+	 */
+	bool is_compressed() const;
+
+	/**
+	 * Returns a pointer to the first byte of the payload
+	 *
+	 * @return first byte of the mapped payload, or nullptr for a compressed
+	 *   file
+	 */
+	const uint8_t* data() const;
+
+	/**
+	 * View the payload of an unsigned byte file as a matrix
+	 *
+	 * The matrix uses the mapped memory directly, so creating it copies
+	 * nothing. It must not outlive the IdxFile, and writes to it are never
+	 * written back to the file.
+	 *
+	 * @return entry_size x num_entries view, or an empty matrix if the file
+	 *   does not hold unsigned bytes or is compressed
+	 */
+	arma::Mat<uint8_t> bytes() const;
+
+	/**
+	 * Release the memory backing a range of entries
+	 *
+	 * Lets the kernel drop the pages of entries that have been consumed, so
+	 * that a sequential pass over a large file keeps a bounded resident set.
+	 * The entries remain readable and are paged back in on the next access.
+	 * For a compressed file, the compressed input consumed so far is released.
+	 *
+	 * @param[in] first index of the first entry
+	 * @param[in] count number of entries
+	 */
+	void release( arma::uword first, arma::uword count ) const;
+
+	/**
+	 * Read a range of entries
+	 *
+	 * Reads the elements of entries [first, first+count) into out, whatever
+	 * the element type of the file. When eT is the element type of the file
+	 * the payload is copied in bulk and byte-swapped in place; otherwise
+	 * each element is loaded, swapped and converted in a single pass over
+	 * contiguous memory, which the compiler vectorizes.
+	 *
+	 * A compressed payload is inflated in chunks of kChunkBytes. The next
+	 * chunk is inflated on a second thread while the current one is
+	 * converted into out, so the uncompressed payload is never stored as a
+	 * whole. Reading entries in increasing order is fastest, since reading
+	 * backwards restarts the inflation from the start of the file.
+	 *
+	 * @param[out] out array of count*entry_size elements
+	 * @param[in] first index of the first entry
+	 * @param[in] count number of entries
+	 *
+	 * @return false if a compressed payload ended early or is corrupt
+	 */
+	template<typename eT>
+	bool convert( eT *out, arma::uword first, arma::uword count ) const {
+		size_t n = count*entry_size();
+		if ( this->reader_ == nullptr ) {
+			decode(this->type_, data() + first*entry_size()*element_size(), out, n);
+			return true;
+		}
+
+		std::lock_guard<std::mutex> lock(*this->mutex_);
+		const size_t element_bytes = element_size();
+		if ( !this->reader_->seek(this->offset_ + first*entry_size()*element_bytes) ) {
+			return false;
+		}
+
+		const size_t chunk = kChunkBytes / element_bytes;
+		std::vector<uint8_t> buffers[2] = {
+			std::vector<uint8_t>(chunk*element_bytes),
+			std::vector<uint8_t>(chunk*element_bytes)};
+		utilities::GzipReader *reader = this->reader_.get();
+
+		size_t pending = std::min(chunk, n);
+		bool complete = ( reader->read(buffers[0].data(), pending*element_bytes)
+			== pending*element_bytes );
+		for ( int current = 0; pending > 0 && complete; current = 1 - current ) {
+			const size_t next = std::min(chunk, n - pending);
+			uint8_t *next_buffer = buffers[1 - current].data();
+			std::future<size_t> ahead;
+			if ( next > 0 ) {
+				ahead = std::async(std::launch::async, [=]() {
+					return reader->read(next_buffer, next*element_bytes);
+				});
+			}
+
+			decode(this->type_, buffers[current].data(), out, pending);
+			out += pending;
+			n -= pending;
+
+			if ( next > 0 ) {
+				complete = ( ahead.get() == next*element_bytes );
+			}
+			pending = next;
+		}
+		return complete;
+	}
+
+	/**
+	 * Read a range of entries into a matrix
+	 *
+	 * @param[in] first index of the first entry
+	 * @param[in] count number of entries (defaults to every remaining entry)
+	 *
+	 * @return entry_size x count matrix with an entry in each column, or an
+	 *   empty matrix if the file is not open or its payload is corrupt
+	 */
+	template<typename eT>
+	arma::Mat<eT> to_matrix( arma::uword first = 0,
+							 arma::uword count = ~arma::uword(0) ) const {
+		if ( !is_open() || first > num_entries() ) {
+			return arma::Mat<eT>();
+		}
+		count = std::min(count, num_entries() - first);
+		arma::Mat<eT> matrix = arma::Mat<eT>(entry_size(), count);
+		if ( !convert(matrix.memptr(), first, count) ) {
+			return arma::Mat<eT>();
+		}
+		return matrix;
+	}
+
+	/**
+	 * Read every element into a vector
+	 *
+	 * Intended for one-dimensional files, such as label sets, where each
+	 * entry is a single element.
+	 *
+	 * @return vector of num_entries*entry_size elements, or an empty vector
+	 *   if the file is not open or its payload is corrupt
+	 */
+	template<typename eT>
+	arma::Col<eT> to_vector() const {
+		if ( !is_open() ) {
+			return arma::Col<eT>();
+		}
+		arma::Col<eT> vector = arma::Col<eT>(num_entries()*entry_size());
+		if ( !convert(vector.memptr(), 0, num_entries()) ) {
+			return arma::Col<eT>();
+		}
+		return vector;
+	}
+
+private:
+	/**
+	 * Convert n elements stored as type sT
+	 */
+	template<typename sT, typename eT>
+	static void decode_as( const uint8_t *in, eT *out, size_t n ) {
+		if ( std::is_same<sT, eT>::value ) {
+			memcpy(out, in, n*sizeof(eT));
+			if ( sizeof(eT) > 1 ) {
+				const uint8_t *swapped = reinterpret_cast<const uint8_t*>(out);
+				for ( size_t i = 0; i < n; i++ ) {
+					out[i] = idx::load<eT>(swapped + i*sizeof(eT));
+				}
+			}
+			return;
+		}
+		for ( size_t i = 0; i < n; i++ ) {
+			out[i] = static_cast<eT>(idx::load<sT>(in + i*sizeof(sT)));
+		}
+	}
+
+	/**
+	 * Convert n elements stored as the IDX type with the given type byte
+	 */
+	template<typename eT>
+	static void decode( uint8_t type, const uint8_t *in, eT *out, size_t n ) {
+		switch ( type ) {
+			case kUnsignedByte: decode_as<uint8_t>(in, out, n); break;
+			case kSignedByte: decode_as<int8_t>(in, out, n); break;
+			case kShort: decode_as<int16_t>(in, out, n); break;
+			case kInt: decode_as<int32_t>(in, out, n); break;
+			case kFloat: decode_as<float>(in, out, n); break;
+			case kDouble: decode_as<double>(in, out, n); break;
+		}
+	}
+
+	utilities::MappedFile file_; /// Mapping of the whole file
+	bool valid_; /// Whether the header was parsed successfully
+	uint8_t type_; /// Type byte of the magic number
+	std::vector<uint32_t> dimensions_; /// Size of each dimension
+	size_t offset_; /// Offset of the payload in bytes
+	std::unique_ptr<utilities::GzipReader> reader_; /// Inflater of a gzip file
+	std::unique_ptr<std::mutex> mutex_; /// Serializes reads of a gzip file
+};
+
+}
+
+#endif // OCR_PARSER_IDX_FILE_H_
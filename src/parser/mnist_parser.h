@@ -5,8 +5,8 @@
 
 #include <armadillo>
 
+#include "parser/idx_file.h"
 #include "util/ocrtypes.h"
-#include "util/utilities.h"
 
 namespace ocr {
 	namespace mnist {
@@ -16,20 +16,25 @@ namespace ocr {
 		 *
 		 * Creates a matrix of images from the MNIST dataset file that is
 		 * input to the function. Each image entry is stored in a single
-		 * column of the output matrix.
+		 * column of the output matrix. The file is memory-mapped and its
+		 * pixels are widened to the element type (double by default, or
+		 * float) in a single pass; use IdxFile directly to access the raw
+		 * pixels without a copy. Gzip-compressed files are inflated
+		 * directly into the output matrix.
 		 *
 		 * @param[in] filename input string filename from which to read images
 		 *
 		 * @return matrix of images in designated file
 		 */
-		arma::mat parse_images(const std::string &filename);
+		template<typename eT = double>
+		arma::Mat<eT> parse_images(const std::string &filename);
 
 		/**
 		 * Parse MNIST labels from file
 		 *
 		 * Creates a column vector of labels as read from the specified MNIST
 		 * label dataset. Each i-th entry corresponds to the i-th column of
-		 * the matrix from parse_images.
+		 * the matrix from parse_images. Gzip-compressed files are accepted.
 		 *
 		 * @param[in] filename input string filename from which to read labels
 		 *
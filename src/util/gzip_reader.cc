@@ -0,0 +1,104 @@
+#include "util/gzip_reader.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include <zlib.h>
+
+struct ocr::utilities::GzipReader::State {
+	z_stream stream;
+	bool initialized;
+	bool finished;
+	size_t position;
+};
+
+ocr::utilities::GzipReader::GzipReader( const uint8_t *data, size_t size )
+	: state_(new State()), data_(data), size_(size) {
+	this->state_->initialized = false;
+	rewind();
+}
+
+ocr::utilities::GzipReader::~GzipReader() {
+	if ( this->state_->initialized ) {
+		inflateEnd(&this->state_->stream);
+	}
+}
+
+bool ocr::utilities::GzipReader::is_gzip( const uint8_t *data, size_t size ) {
+	return size >= 18 && data[0] == 0x1F && data[1] == 0x8B;
+}
+
+uint32_t ocr::utilities::GzipReader::trailer_size() const {
+	if ( this->size_ < 4 ) {
+		return 0;
+	}
+	const uint8_t *trailer = this->data_ + this->size_ - 4;
+	return trailer[0] | ( trailer[1] << 8 ) | ( trailer[2] << 16 )
+		| ( (uint32_t)trailer[3] << 24 );
+}
+
+size_t ocr::utilities::GzipReader::read( uint8_t *out, size_t length ) {
+	State &state = *this->state_;
+	size_t produced = 0;
+
+	while ( produced < length && !state.finished ) {
+		// avail_in and avail_out are 32-bit, so large requests are split
+		const size_t request = std::min<size_t>(length - produced, UINT_MAX);
+		if ( state.stream.avail_in == 0 ) {
+			const size_t offset = state.stream.next_in - this->data_;
+			state.stream.avail_in = std::min<size_t>(this->size_ - offset, UINT_MAX);
+		}
+		state.stream.next_out = out + produced;
+		state.stream.avail_out = request;
+
+		int status = inflate(&state.stream, Z_NO_FLUSH);
+		produced += request - state.stream.avail_out;
+		if ( status == Z_STREAM_END || ( status != Z_OK && status != Z_BUF_ERROR )
+			|| ( status == Z_BUF_ERROR && state.stream.avail_in == 0 ) ) {
+			state.finished = true;
+		}
+	}
+
+	state.position += produced;
+	return produced;
+}
+
+bool ocr::utilities::GzipReader::seek( size_t position ) {
+	if ( position < this->state_->position ) {
+		rewind();
+	}
+
+	uint8_t buffer[16384];
+	while ( this->state_->position < position ) {
+		size_t length = std::min(sizeof(buffer), position - this->state_->position);
+		if ( read(buffer, length) < length ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t ocr::utilities::GzipReader::position() const {
+	return this->state_->position;
+}
+
+size_t ocr::utilities::GzipReader::consumed() const {
+	return this->state_->stream.total_in;
+}
+
+void ocr::utilities::GzipReader::rewind() {
+	State &state = *this->state_;
+	if ( state.initialized ) {
+		inflateEnd(&state.stream);
+	}
+
+	memset(&state.stream, 0, sizeof(state.stream));
+	state.stream.next_in = const_cast<Bytef*>(this->data_);
+	state.stream.avail_in = std::min<size_t>(this->size_, UINT_MAX);
+	state.position = 0;
+
+	// A window of 16+MAX_WBITS accepts only the gzip format
+	state.initialized = ( inflateInit2(&state.stream, 16 + MAX_WBITS) == Z_OK );
+	state.finished = !state.initialized;
+}
@@ -0,0 +1,91 @@
+#ifndef OCR_UTIL_GZIP_READER_H_
+#define OCR_UTIL_GZIP_READER_H_
+
+#include <stdint.h>
+
+#include <memory>
+
+namespace ocr {
+	namespace utilities {
+		/**
+		 * A sequential reader of gzip-compressed memory
+		 *
+		 * Inflates a gzip stream held in memory (such as a MappedFile) on
+		 * demand, so that the uncompressed data never needs to exist as a
+		 * whole. Reads are sequential; seeking backwards rewinds the stream.
+		 */
+		class GzipReader {
+		public:
+			/**
+			 * Start reading a gzip stream
+			 *
+			 * @param[in] data first byte of the compressed stream
+			 * @param[in] size size of the compressed stream in bytes
+			 */
+			GzipReader( const uint8_t *data, size_t size );
+			~GzipReader();
+
+			GzipReader( const GzipReader& ) = delete;
+			GzipReader &operator=( const GzipReader& ) = delete;
+
+			/**
+			 * Returns true if the memory starts with the gzip magic number
+			 *
+			 * @param[in] data first byte of the memory
+			 * @param[in] size size of the memory in bytes
+			 */
+			static bool is_gzip( const uint8_t *data, size_t size );
+
+			/**
+			 * Returns the uncompressed size recorded in the gzip trailer
+			 *
+			 * The trailer stores the size modulo 2^32, and only for the last
+			 * member of the stream.
+			 */
+			uint32_t trailer_size() const;
+
+			/**
+			 * Inflate the next bytes of the stream
+			 *
+			 * @param[out] out array of at least length bytes
+			 * @param[in] length number of bytes to inflate
+			 *
+			 * @return number of bytes inflated, which is less than length only
+			 *   at the end of the stream or if the stream is corrupt
+			 */
+			size_t read( uint8_t *out, size_t length );
+
+			/**
+			 * Move to an offset of the uncompressed stream
+			 *
+			 * @param[in] position offset of the next byte to read
+			 *
+			 * @return true if the stream holds that many bytes
+			 */
+			bool seek( size_t position );
+
+			/**
+			 * Returns the offset of the next uncompressed byte to read
+			 */
+			size_t position() const;
+
+			/**
+			 * Returns the number of compressed bytes consumed so far
+			 */
+			size_t consumed() const;
+
+		private:
+			/**
+			 * Restart inflation from the beginning of the stream
+			 */
+			void rewind();
+
+			struct State;
+			std::unique_ptr<State> state_; /// zlib stream state
+			const uint8_t *data_; /// Compressed stream
+			size_t size_; /// Size of the compressed stream
+		};
+	}
+}
+
+#endif // OCR_UTIL_GZIP_READER_H_
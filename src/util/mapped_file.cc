@@ -0,0 +1,46 @@
+#include "util/mapped_file.h"
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ocr::utilities::MappedFile::MappedFile( const std::string &filename ) {
+	this->data_ = nullptr;
+	this->size_ = 0;
+
+	int descriptor = open(filename.c_str(), O_RDONLY);
+	if ( descriptor < 0 ) {
+		return;
+	}
+
+	struct stat status;
+	if ( fstat(descriptor, &status) == 0 && status.st_size > 0 ) {
+		void *mapping = mmap(nullptr, status.st_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE, descriptor, 0);
+		if ( mapping != MAP_FAILED ) {
+			this->data_ = (uint8_t*)mapping;
+			this->size_ = status.st_size;
+		}
+	}
+
+	// The mapping remains valid once the descriptor is closed
+	close(descriptor);
+}
+
+ocr::utilities::MappedFile::~MappedFile() {
+	if ( this->data_ != nullptr ) {
+		munmap(this->data_, this->size_);
+	}
+}
+
+void ocr::utilities::MappedFile::release( size_t offset, size_t length ) const {
+	const size_t page = sysconf(_SC_PAGESIZE);
+	const size_t first = ( offset + page - 1 ) / page * page;
+	const size_t last = std::min(offset + length, this->size_) / page * page;
+	if ( this->data_ != nullptr && first < last ) {
+		madvise(this->data_ + first, last - first, MADV_DONTNEED);
+	}
+}
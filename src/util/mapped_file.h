@@ -0,0 +1,77 @@
+#ifndef OCR_UTIL_MAPPED_FILE_H_
+#define OCR_UTIL_MAPPED_FILE_H_
+
+#include <stdint.h>
+
+#include <string>
+
+namespace ocr {
+	namespace utilities {
+		/**
+		 * A file mapped into memory
+		 *
+		 * Maps the whole file into the address space of the process so that
+		 * its contents can be read without copying them into a buffer. The
+		 * mapping is private and writable: writes through data() are
+		 * copy-on-write and never reach the file. The mapping is released
+		 * when the object is destroyed.
+		 */
+		class MappedFile {
+		public:
+			/**
+			 * Map a file into memory
+			 *
+			 * The file is unmapped (is_open returns false) if it cannot be
+			 * opened or is empty.
+			 *
+			 * @param[in] filename name of the file to map
+			 */
+			explicit MappedFile( const std::string &filename );
+			~MappedFile();
+
+			MappedFile( const MappedFile& ) = delete;
+			MappedFile &operator=( const MappedFile& ) = delete;
+
+			/**
+			 * Returns true if the file is mapped
+			 */
+			bool is_open() const {
+				return this->data_ != nullptr;
+			}
+
+			/**
+			 * Returns the first byte of the mapping
+			 */
+			uint8_t* data() const {
+				return this->data_;
+			}
+
+			/**
+			 * Returns the size of the file in bytes
+			 */
+			size_t size() const {
+				return this->size_;
+			}
+
+			/**
+			 * Release the physical pages backing a range of the mapping
+			 *
+			 * Advises the kernel that the pages fully covered by the range
+			 * will not be needed soon, so that a sequential reader keeps a
+			 * bounded resident set. The range remains readable and is paged
+			 * back in from the file on the next access. Pages modified
+			 * through data() must not be released.
+			 *
+			 * @param[in] offset offset of the range in bytes
+			 * @param[in] length length of the range in bytes
+			 */
+			void release( size_t offset, size_t length ) const;
+
+		private:
+			uint8_t *data_; /// Start of the mapping
+			size_t size_; /// Length of the mapping
+		};
+	}
+}
+
+#endif // OCR_UTIL_MAPPED_FILE_H_
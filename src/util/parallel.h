@@ -0,0 +1,124 @@
+#ifndef OCR_UTIL_PARALLEL_H_
+#define OCR_UTIL_PARALLEL_H_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace ocr {
+	namespace utilities {
+		/**
+		 * A copyable counter that threads may increment concurrently
+		 *
+		 * Wraps an atomic integer for statistics gathered during parallel
+		 * queries. Copying a counter copies its current value, so classes
+		 * holding one remain copyable.
+		 */
+		class AtomicCounter {
+		public:
+			AtomicCounter( uint64_t value = 0 ) : value_(value) {}
+			AtomicCounter( const AtomicCounter &other ) : value_(other.get()) {}
+
+			AtomicCounter &operator=( const AtomicCounter &other ) {
+				this->value_ = other.get();
+				return *this;
+			}
+
+			void add( uint64_t amount ) {
+				this->value_.fetch_add(amount, std::memory_order_relaxed);
+			}
+
+			uint64_t get() const {
+				return this->value_.load(std::memory_order_relaxed);
+			}
+
+			void reset() {
+				this->value_ = 0;
+			}
+
+		private:
+			std::atomic<uint64_t> value_;
+		};
+
+		/**
+		 * Number of threads to use for a requested thread count
+		 *
+		 * Resolves a requested number of threads, where 0 designates one
+		 * thread per hardware core.
+		 *
+		 * @param[in] num_threads requested number of threads (0 = all cores)
+		 *
+		 * @return number of threads to launch (at least 1)
+		 */
+		inline size_t resolve_threads(size_t num_threads) {
+			if ( num_threads == 0 ) {
+				num_threads = std::thread::hardware_concurrency();
+			}
+			return std::max<size_t>(num_threads, 1);
+		}
+
+		/**
+		 * Split a range of indices across worker threads
+		 *
+		 * Partitions the range [0, n) into at most num_threads contiguous
+		 * chunks of nearly equal size and calls worker(first, last) on each
+		 * chunk from its own thread. The calling thread processes the first
+		 * chunk itself. The partition only depends on n and num_threads, so a
+		 * worker that writes to the indices of its own chunk produces the same
+		 * result for any number of threads. The first exception thrown by a
+		 * worker is rethrown once every thread has joined.
+		 *
+		 * @param[in] n number of indices in the range
+		 * @param[in] num_threads maximum number of threads (0 = all cores)
+		 * @param[in] worker callable taking the first and one-past-last index
+		 */
+		template<typename Function>
+		void parallel_for(size_t n, size_t num_threads, Function worker) {
+			num_threads = std::min(resolve_threads(num_threads), n);
+			if ( num_threads <= 1 ) {
+				if ( n > 0 ) {
+					worker(0, n);
+				}
+				return;
+			}
+
+			std::vector<size_t> bounds(num_threads + 1, 0);
+			for ( size_t t = 0; t < num_threads; t++ ) {
+				bounds[t+1] = bounds[t] + n / num_threads
+					+ ( t < n % num_threads ? 1 : 0 );
+			}
+
+			std::vector<std::exception_ptr> errors(num_threads);
+			auto run = [&worker, &bounds, &errors](size_t t) {
+				try {
+					worker(bounds[t], bounds[t+1]);
+				}
+				catch ( ... ) {
+					errors[t] = std::current_exception();
+				}
+			};
+
+			std::vector<std::thread> threads;
+			for ( size_t t = 1; t < num_threads; t++ ) {
+				threads.push_back(std::thread(run, t));
+			}
+			run(0);
+
+			for ( auto &thread : threads ) {
+				thread.join();
+			}
+
+			for ( auto &error : errors ) {
+				if ( error ) {
+					std::rethrow_exception(error);
+				}
+			}
+		}
+	}
+}
+
+#endif // OCR_UTIL_PARALLEL_H_
@@ -1,11 +1,54 @@
 #include "util/principle_component_analysis.h"
 
-ocr::PCA::PCA() {
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+#include "util/parallel.h"
+
+namespace {
+
+/**
+ * Key identifying a saved model of the class and element type
+ */
+template<typename eT>
+uint64_t model_key() {
+	return ocr::DatasetCache::hash({}, std::string("ocr::PCA<")
+		+ std::to_string(ocr::cache::TypeCode<eT>::value) + ">");
+}
+
+}
+
+template<typename eT>
+const size_t ocr::BasicPCA<eT>::kCovarianceRatio;
+template<typename eT>
+const size_t ocr::BasicPCA<eT>::kBlockSize;
+template<typename eT>
+const size_t ocr::BasicPCA<eT>::kRetainedOversampling;
+
+template<typename eT>
+ocr::BasicPCA<eT>::BasicPCA() {
+	this->num_reduced_dimensions_ = 0;
+	this->percent_variability_ = 0;
 	this->dimension_select_mode_ = AUTO;
+	this->solver_ = AUTO_SOLVER;
+	this->oversampling_ = 10;
+	this->power_iterations_ = 1;
+	this->num_retained_ = 0;
+	this->num_samples_ = 0;
+	this->total_scatter_ = 0;
 }
 
-ocr::PCA::PCA(int num_reduced_dimensions) {
+template<typename eT>
+ocr::BasicPCA<eT>::BasicPCA(int num_reduced_dimensions) {
 	this->num_reduced_dimensions_ = num_reduced_dimensions;
+	this->percent_variability_ = 0;
+	this->solver_ = AUTO_SOLVER;
+	this->oversampling_ = 10;
+	this->power_iterations_ = 1;
+	this->num_retained_ = 0;
+	this->num_samples_ = 0;
+	this->total_scatter_ = 0;
 
 	if ( num_reduced_dimensions <= 0 ) {
 		this->dimension_select_mode_ = AUTO;
@@ -15,32 +58,307 @@ ocr::PCA::PCA(int num_reduced_dimensions) {
 	}
 }
 
-ocr::PCA::PCA(double percent_variability) {
+template<typename eT>
+ocr::BasicPCA<eT>::BasicPCA(double percent_variability) {
+	this->num_reduced_dimensions_ = 0;
 	this->percent_variability_ = percent_variability;
 	this->dimension_select_mode_ = PERCENT_VARIABILITY;
+	this->solver_ = AUTO_SOLVER;
+	this->oversampling_ = 10;
+	this->power_iterations_ = 1;
+	this->num_retained_ = 0;
+	this->num_samples_ = 0;
+	this->total_scatter_ = 0;
 }
 
-void ocr::PCA::solve( const arma::mat &dataset ) {
+template<typename eT>
+void ocr::BasicPCA<eT>::solve( const arma::Mat<eT> &dataset ) {
 
 	size_t num_vars = dataset.n_rows;
+	this->num_samples_ = 0;
+
+	Solver solver = this->solver_;
+	if ( solver == RANDOMIZED_SOLVER ) {
+		if ( this->dimension_select_mode_ == NUM_DIMENSIONS ) {
+			solve_randomized(dataset);
+			return;
+		}
+		// The other modes need the whole spectrum
+		solver = AUTO_SOLVER;
+	}
+	if ( solver == AUTO_SOLVER ) {
+		solver = ( dataset.n_cols >= kCovarianceRatio*num_vars )
+			? COVARIANCE_SOLVER : SVD_SOLVER;
+	}
+
+	if ( solver == COVARIANCE_SOLVER ) {
+		// Center and accumulate one block of columns at a time rather than
+		// copying the whole dataset
+		arma::Col<eT> mean = arma::zeros<arma::Col<eT>>(num_vars);
+		arma::Mat<eT> scatter = arma::zeros<arma::Mat<eT>>(num_vars, num_vars);
+		size_t num_samples = 0;
+		for ( size_t first = 0; first < dataset.n_cols; first += kBlockSize ) {
+			size_t last = std::min<size_t>(first + kBlockSize, dataset.n_cols) - 1;
+			arma::Mat<eT> block = dataset.cols(first, last);
+			accumulate_scatter(block, mean, scatter, num_samples);
+		}
+		solve_scatter(scatter, num_samples);
+		return;
+	}
 
-	arma::mat dataset_mean = arma::mean(dataset,1);
+	arma::Mat<eT> dataset_mean = arma::mean(dataset,1);
 
-	arma::mat dataset_0mean = dataset;
+	arma::Mat<eT> dataset_0mean = dataset;
 	dataset_0mean.each_col() -= dataset_mean;
 
-	arma::mat M = arma::mat(num_vars, num_vars);
-	arma::vec S = arma::vec(num_vars);
-	arma::mat N = arma::mat(num_vars, num_vars);
-	arma::svd_econ(M,S,N, dataset_0mean.t(), "right");
-	arma::mat eigenvectors = N;
-	arma::vec eigenvalues = arma::square(S)/num_vars;
+	// The left singular vectors of the centered dataset are the right
+	// singular vectors of its transpose, without forming the transpose
+	arma::Mat<eT> M;
+	arma::Col<eT> S;
+	arma::Mat<eT> N;
+	arma::svd_econ(M,S,N, dataset_0mean, "left");
+	arma::Mat<eT> eigenvectors = M;
+	arma::Col<eT> eigenvalues = arma::square(S)/num_vars;
+
+	select_projection(eigenvectors, eigenvalues, dataset.n_cols,
+		arma::sum(eigenvalues));
+}
+
+template<typename eT>
+void ocr::BasicPCA<eT>::solve( BasicDatasetStream<eT> &stream ) {
+
+	size_t num_vars = stream.entry_size();
+	this->num_samples_ = 0;
+
+	arma::Col<eT> mean = arma::zeros<arma::Col<eT>>(num_vars);
+	arma::Mat<eT> scatter = arma::zeros<arma::Mat<eT>>(num_vars, num_vars);
+	size_t num_samples = 0;
+
+	stream.reset();
+	arma::Mat<eT> batch;
+	while ( stream.next(batch) ) {
+		accumulate_scatter(batch, mean, scatter, num_samples);
+	}
+
+	solve_scatter(scatter, num_samples);
+}
+
+template<typename eT>
+void ocr::BasicPCA<eT>::solve_randomized( const arma::Mat<eT> &dataset ) {
+
+	const size_t num_vars = dataset.n_rows;
+	const size_t num_samples = dataset.n_cols;
+	const size_t rank = std::min<size_t>(this->num_reduced_dimensions_
+		+ this->oversampling_, std::min(num_vars, num_samples));
+
+	arma::Col<eT> mean = arma::mean(dataset, 1);
+
+	// The centered dataset X - mean*1' is only ever applied to thin matrices,
+	// so it is never formed
+	std::mt19937 generator(0);
+	std::normal_distribution<double> normal;
+	arma::Mat<eT> omega = arma::Mat<eT>(num_samples, rank);
+	omega.imbue([&]() { return normal(generator); });
+
+	arma::Mat<eT> Q;
+	arma::Mat<eT> R;
+	arma::qr_econ(Q, R, dataset*omega - mean*arma::sum(omega, 0));
+	for ( size_t i = 0; i < this->power_iterations_; i++ ) {
+		arma::Mat<eT> Z;
+		arma::qr_econ(Z, R, dataset.t()*Q
+			- arma::ones<arma::Col<eT>>(num_samples)*(mean.t()*Q));
+		arma::qr_econ(Q, R, dataset*Z - mean*arma::sum(Z, 0));
+	}
+
+	// Project the centered dataset onto the range and decompose the result
+	arma::Mat<eT> B = Q.t()*dataset
+		- (Q.t()*mean)*arma::ones<arma::Row<eT>>(num_samples);
+	arma::Mat<eT> U;
+	arma::Col<eT> S;
+	arma::Mat<eT> V;
+	arma::svd_econ(U, S, V, B, "left");
+
+	// The variability of the truncated spectrum is measured against the
+	// total variance of the dataset, accumulated one block at a time
+	double total_variance = 0;
+	for ( size_t first = 0; first < num_samples; first += kBlockSize ) {
+		size_t last = std::min<size_t>(first + kBlockSize, num_samples) - 1;
+		arma::Mat<eT> block = dataset.cols(first, last);
+		block.each_col() -= mean;
+		total_variance += arma::accu(arma::square(block));
+	}
+
+	select_projection(Q*U, arma::square(S)/num_vars, num_samples,
+		total_variance/num_vars);
+}
+
+template<typename eT>
+void ocr::BasicPCA<eT>::update( const arma::Mat<eT> &batch ) {
+
+	if ( this->dimension_select_mode_ == AUTO ) {
+		throw std::invalid_argument("incremental updates need a set number of "
+			"dimensions or percent variability");
+	}
+	if ( this->num_samples_ > 0 && batch.n_rows != this->mean_.n_rows ) {
+		throw std::invalid_argument("batch dimensions do not match previous updates");
+	}
+	if ( batch.n_cols == 0 ) {
+		return;
+	}
+
+	const size_t num_vars = batch.n_rows;
+	const double n = this->num_samples_;
+	const double m = batch.n_cols;
+	if ( this->num_samples_ == 0 ) {
+		this->mean_ = arma::zeros<arma::Col<eT>>(num_vars);
+		this->basis_.reset();
+		this->singular_values_.reset();
+		this->total_scatter_ = 0;
+	}
+
+	// Stack the weighted retained components, the centered batch and the
+	// correction for the shift of the mean between the two
+	const size_t num_components = this->basis_.n_cols;
+	arma::Col<eT> batch_mean = arma::mean(batch, 1);
+	arma::Mat<eT> stacked = arma::Mat<eT>(num_vars, num_components + batch.n_cols + 1);
+	if ( num_components > 0 ) {
+		stacked.cols(0, num_components-1) =
+			this->basis_*arma::diagmat(this->singular_values_);
+	}
+	stacked.cols(num_components, num_components + batch.n_cols - 1) = batch;
+	stacked.cols(num_components, num_components + batch.n_cols - 1).each_col()
+		-= batch_mean;
+	stacked.col(stacked.n_cols-1) = std::sqrt(n*m/(n + m))*(batch_mean - this->mean_);
+
+	this->total_scatter_ += arma::accu(arma::square(stacked.cols(num_components,
+		stacked.n_cols-1)));
+	this->mean_ += (batch_mean - this->mean_)*(m/(n + m));
+	this->num_samples_ += batch.n_cols;
+
+	arma::Mat<eT> U;
+	arma::Col<eT> S;
+	arma::Mat<eT> V;
+	arma::svd_econ(U, S, V, stacked, "left");
+
+	size_t num_retained = this->num_retained_;
+	if ( num_retained == 0 ) {
+		num_retained = ( this->dimension_select_mode_ == NUM_DIMENSIONS )
+			? this->num_reduced_dimensions_ + kRetainedOversampling : num_vars;
+	}
+	num_retained = std::min<size_t>(num_retained, S.n_elem);
+	this->basis_ = U.cols(0, num_retained-1);
+	this->singular_values_ = S.head(num_retained);
+
+	// Too few entries have been seen to span the requested dimensions
+	if ( this->dimension_select_mode_ == NUM_DIMENSIONS
+		&& num_retained < this->num_reduced_dimensions_ ) {
+		this->projection_matrix_.reset();
+		return;
+	}
+
+	select_projection(this->basis_, arma::square(this->singular_values_)/num_vars,
+		this->num_samples_, this->total_scatter_/num_vars);
+}
+
+template<typename eT>
+void ocr::BasicPCA<eT>::update( BasicDatasetStream<eT> &stream ) {
+	stream.reset();
+	arma::Mat<eT> batch;
+	while ( stream.next(batch) ) {
+		update(batch);
+	}
+}
 
-	arma::vec percent_variability = arma::cumsum(eigenvalues)/arma::sum(eigenvalues);
+template<typename eT>
+void ocr::BasicPCA<eT>::set_retained_components(size_t num_retained) {
+	this->num_retained_ = num_retained;
+}
+
+template<typename eT>
+size_t ocr::BasicPCA<eT>::get_num_samples() {
+	return this->num_samples_;
+}
+
+template<typename eT>
+void ocr::BasicPCA<eT>::set_solver(Solver solver) {
+	this->solver_ = solver;
+}
+
+template<typename eT>
+void ocr::BasicPCA<eT>::set_randomized_parameters(size_t oversampling,
+		size_t power_iterations) {
+	this->oversampling_ = oversampling;
+	this->power_iterations_ = power_iterations;
+}
+
+template<typename eT>
+double ocr::BasicPCA<eT>::subspace_distance(const BasicPCA &other) const {
+	if ( this->projection_matrix_.n_cols != other.projection_matrix_.n_cols ) {
+		throw std::invalid_argument("projections must have the same input dimensions");
+	}
+
+	if ( this->projection_matrix_.n_rows != other.projection_matrix_.n_rows
+		|| this->projection_matrix_.is_empty() ) {
+		return 1.0;
+	}
+
+	// The singular values of P1*P2' are the cosines of the principal angles
+	// between the two subspaces
+	arma::Col<eT> cosines =
+		arma::svd(this->projection_matrix_*other.projection_matrix_.t());
+	return std::sqrt(std::max(0.0, 1.0 - std::pow(cosines.min(), 2)));
+}
+
+template<typename eT>
+typename ocr::BasicPCA<eT>::Solver ocr::BasicPCA<eT>::get_solver() {
+	return this->solver_;
+}
+
+template<typename eT>
+void ocr::BasicPCA<eT>::accumulate_scatter(arma::Mat<eT> &batch,
+		arma::Col<eT> &mean, arma::Mat<eT> &scatter, size_t &num_samples) {
+	arma::Col<eT> batch_mean = arma::mean(batch, 1);
+	batch.each_col() -= batch_mean;
+
+	const double total = num_samples + batch.n_cols;
+	arma::Col<eT> delta = batch_mean - mean;
+	scatter += batch*batch.t()
+		+ delta*delta.t()*(num_samples*batch.n_cols/total);
+	mean += delta*(batch.n_cols/total);
+	num_samples += batch.n_cols;
+}
+
+template<typename eT>
+void ocr::BasicPCA<eT>::solve_scatter(const arma::Mat<eT> &scatter,
+		const size_t n_samples) {
+	arma::Col<eT> eigenvalues;
+	arma::Mat<eT> eigenvectors;
+	arma::eig_sym(eigenvalues, eigenvectors, scatter);
+
+	// eig_sym orders the eigenvalues in ascending order. The eigenvalues of
+	// the scatter matrix are the squared singular values of the centered
+	// dataset, so they are scaled as in the SVD route
+	eigenvalues = arma::clamp(arma::flipud(eigenvalues), 0,
+		std::numeric_limits<eT>::max())/scatter.n_rows;
+	eigenvectors = arma::fliplr(eigenvectors);
+
+	select_projection(eigenvectors, eigenvalues, n_samples,
+		arma::sum(eigenvalues));
+}
+
+template<typename eT>
+void ocr::BasicPCA<eT>::select_projection(const arma::Mat<eT> &eigenvectors,
+		const arma::Col<eT> &eigenvalues, const size_t n_samples,
+		const double total_variance) {
+
+	// The dimensions are selected in double precision whatever the element
+	// type of the components
+	const arma::vec spectrum = arma::conv_to<arma::vec>::from(eigenvalues);
+	arma::vec percent_variability = arma::cumsum(spectrum)/total_variance;
 	switch ( this->dimension_select_mode_ ) {
 		case AUTO:
 			this->num_reduced_dimensions_ =
-				determine_dimensions(eigenvalues, dataset.n_cols);
+				determine_dimensions(spectrum, n_samples);
 		case NUM_DIMENSIONS:
 			this->percent_variability_ =
 				percent_variability[this->num_reduced_dimensions_-1];
@@ -53,10 +371,11 @@ void ocr::PCA::solve( const arma::mat &dataset ) {
 	}
 
 	this->projection_matrix_ = eigenvectors.cols(0, this->num_reduced_dimensions_-1).t();
-	return;
 }
 
-arma::mat ocr::PCA::project( const arma::mat &dataset, bool reverse ) {
+template<typename eT>
+arma::Mat<eT> ocr::BasicPCA<eT>::project( const arma::Mat<eT> &dataset,
+		bool reverse ) {
 
 	if ( reverse ) {
 		return this->projection_matrix_.t() * dataset;
@@ -67,70 +386,179 @@ arma::mat ocr::PCA::project( const arma::mat &dataset, bool reverse ) {
 
 }
 
-void ocr::PCA::set_percent_variability(double variability) {
+template<typename eT>
+void ocr::BasicPCA<eT>::set_percent_variability(double variability) {
 	this->percent_variability_ = variability;
 	this->dimension_select_mode_ = PERCENT_VARIABILITY;
 }
 
-double ocr::PCA::get_percent_variability() {
+template<typename eT>
+double ocr::BasicPCA<eT>::get_percent_variability() {
 	return this->percent_variability_;
 }
 
-void ocr::PCA::set_dimensions(uint32_t dimensions) {
+template<typename eT>
+void ocr::BasicPCA<eT>::set_dimensions(uint32_t dimensions) {
 	this->num_reduced_dimensions_ = dimensions;
 	this->dimension_select_mode_ = NUM_DIMENSIONS;
 }
 
-uint32_t ocr::PCA::get_dimensions() {
+template<typename eT>
+uint32_t ocr::BasicPCA<eT>::get_dimensions() {
 	return this->num_reduced_dimensions_;
 }
 
-void ocr::PCA::set_auto_dimension() {
+template<typename eT>
+const arma::Mat<eT> &ocr::BasicPCA<eT>::get_projection_matrix() const {
+	return this->projection_matrix_;
+}
+
+template<typename eT>
+void ocr::BasicPCA<eT>::set_projection_matrix(const arma::Mat<eT> &projection) {
+	this->projection_matrix_ = projection;
+	this->num_reduced_dimensions_ = projection.n_rows;
+}
+
+template<typename eT>
+void ocr::BasicPCA<eT>::set_auto_dimension() {
 	this->dimension_select_mode_ = AUTO;
 }
 
-size_t ocr::PCA::determine_dimensions(const arma::vec &eigenvalues,
+template<typename eT>
+bool ocr::BasicPCA<eT>::save( std::ostream &ostream ) const {
+	const arma::vec parameters = {double(this->num_reduced_dimensions_),
+		this->percent_variability_, double(this->dimension_select_mode_),
+		double(this->solver_), double(this->oversampling_),
+		double(this->power_iterations_), double(this->num_retained_),
+		double(this->num_samples_), this->total_scatter_};
+
+	ocr::DatasetCacheWriter writer;
+	writer.add("parameters", parameters);
+	writer.add("projection", this->projection_matrix_);
+	writer.add("mean", this->mean_);
+	writer.add("basis", this->basis_);
+	writer.add("singular_values", this->singular_values_);
+	return writer.write(ostream, model_key<eT>());
+}
+
+template<typename eT>
+bool ocr::BasicPCA<eT>::load( std::istream &istream ) {
+	const ocr::DatasetCache model(istream);
+	if ( !model.is_open()
+		|| model.get_key() != model_key<eT>()
+		|| !model.verify() ) {
+		return false;
+	}
+
+	const arma::vec parameters = model.get<double>("parameters");
+	if ( parameters.n_elem != 9 ) {
+		return false;
+	}
+
+	this->num_reduced_dimensions_ = parameters[0];
+	this->percent_variability_ = parameters[1];
+	this->dimension_select_mode_ = Mode(int(parameters[2]));
+	this->solver_ = Solver(int(parameters[3]));
+	this->oversampling_ = parameters[4];
+	this->power_iterations_ = parameters[5];
+	this->num_retained_ = parameters[6];
+	this->num_samples_ = parameters[7];
+	this->total_scatter_ = parameters[8];
+	this->projection_matrix_ = model.get<eT>("projection");
+	this->mean_ = model.get<eT>("mean");
+	this->basis_ = model.get<eT>("basis");
+	this->singular_values_ = model.get<eT>("singular_values");
+	return true;
+}
+
+template<typename eT>
+size_t ocr::BasicPCA<eT>::determine_dimensions(const arma::vec &eigenvalues,
 		const size_t n_samples) {
 	const size_t d = eigenvalues.n_rows;
-	const size_t N = n_samples;
+	const double N = n_samples;
+	if ( d < 2 ) {
+		return d;
+	}
+
+	// The evidence of every k is assembled from sums over the eigenvalues,
+	// each accumulated once as a prefix sum (index k covers i <= k):
+	//   prior[k]  = sum_{i<=k} lgamma(l_i) - l_i*log(pi) - N/2*log(lambda_i)
+	//   tail[k]   = sum_{j>k} lambda_j
+	//   within[k] = sum_{i<j<=k} log((1/lambda_j - 1/lambda_i)(lambda_i - lambda_j))
+	//   across[k] = sum_{i<=k<j} log(lambda_i - lambda_j)
+	// where within and across are built from the row and column sums of the
+	// pairwise terms.
+	arma::vec within_column = arma::zeros<arma::vec>(d+1);
+	arma::vec across_column = arma::zeros<arma::vec>(d+1);
+	arma::vec across_row = arma::zeros<arma::vec>(d+1);
+	ocr::utilities::parallel_for(d, 0, [&](size_t first, size_t last) {
+		for ( size_t t = first; t < last; t++ ) {
+			const size_t j = t + 1;
+			const double lambda_j = eigenvalues[j-1];
+			double within = 0;
+			double across = 0;
+			for ( size_t i = 1; i < j; i++ ) {
+				const double lambda_i = eigenvalues[i-1];
+				const double gap = log(lambda_i - lambda_j);
+				within += log(1/lambda_j - 1/lambda_i) + gap;
+				across += gap;
+			}
+			within_column[j] = within;
+			across_column[j] = across;
+
+			double row = 0;
+			for ( size_t k = j+1; k <= d; k++ ) {
+				row += log(lambda_j - eigenvalues[k-1]);
+			}
+			across_row[j] = row;
+		}
+	});
+
+	arma::vec prior = arma::zeros<arma::vec>(d+1);
+	arma::vec within = arma::zeros<arma::vec>(d+1);
+	arma::vec across = arma::zeros<arma::vec>(d+1);
+	arma::vec tail = arma::zeros<arma::vec>(d+1);
+	for ( size_t k = 1; k <= d; k++ ) {
+		const double l = (d - k + 1.)/2;
+		prior[k] = prior[k-1] + lgamma(l) - l*log(M_PI)
+			- N/2*log(eigenvalues[k-1]);
+		within[k] = within[k-1] + within_column[k];
+		across[k] = across[k-1] - across_column[k] + across_row[k];
+	}
+	for ( size_t k = d; k > 0; k-- ) {
+		tail[k-1] = tail[k] + eigenvalues[k-1];
+	}
 
 	arma::vec likelihood = arma::vec(d);
 	likelihood[0] = -DBL_MAX;
 
-	for ( size_t k = 1; k < d; k++ ) {
-		arma::vec eigenvalue_estimate = eigenvalues;
-		eigenvalue_estimate.rows(k,d-1).each_row() =
-				arma::rowvec({arma::mean(eigenvalue_estimate.rows(k,d-1))});
+	ocr::utilities::parallel_for(d-1, 0, [&](size_t first, size_t last) {
+		for ( size_t t = first; t < last; t++ ) {
+			const size_t k = t + 1;
 
-		size_t m = (size_t)(d*k - k*(k-1)/2.0);
-		// size_t m = (size_t)(d*(d-1.)/2. - (d-k)*(d-k-1.)/2.);
+			size_t m = (size_t)(d*k - k*(k-1)/2.0);
+			// size_t m = (size_t)(d*(d-1.)/2. - (d-k)*(d-k-1.)/2.);
 
-		double pD = 1./2*k*log(2.) + (m+k)/2.*log(2*M_PI) - k/2.*log(N);
+			double pD = 1./2*k*log(2.) + (m+k)/2.*log(2*M_PI) - k/2.*log(N);
+			pD += prior[k];
 
-		for ( size_t i = 1; i <= k; i++ ) {
-			double l = (d - i + 1.)/2;
-			pD += lgamma(l) - l*log(M_PI) - N/2*log(eigenvalues[i-1]);
-		}
+			const double v = tail[k]/(d-k);
+			pD -= N*(d-k)/2.*log(v);
 
-		double v = 0;
-		for ( size_t i = k+1; i <= d; i++ ) {
-			v += eigenvalues[i-1];
-		}
-		v /= (d-k);
-		pD -= N*(d-k)/2.*log(v);
-
-		double log_det_Az = 0.;
-		for ( size_t i = 1; i <= k; i++ ) {
-			for ( size_t j = i+1; j <= d; j++ ) {
-				log_det_Az += log(
-					(1/eigenvalue_estimate[j-1] - 1/eigenvalue_estimate[i-1])
-						* (eigenvalues[i-1] - eigenvalues[j-1])) + log(N);
+			// Pairs with j > k use the estimate v in place of lambda_j
+			double log_det_Az = within[k] + across[k];
+			for ( size_t i = 1; i <= k; i++ ) {
+				log_det_Az += (d-k)*log(1/v - 1/eigenvalues[i-1]);
 			}
-		}
-		pD -= 1/2 * log_det_Az;
+			log_det_Az += (k*d - k*(k+1)/2.)*log(N);
+			pD -= 1./2 * log_det_Az;
 
-		likelihood[k] = pD;
-	}
+			likelihood[k] = pD;
+		}
+	});
 
 	return likelihood.index_max();
-}
\ No newline at end of file
+}
+
+template class ocr::BasicPCA<double>;
+template class ocr::BasicPCA<float>;
@@ -3,11 +3,15 @@
 
 #include <float.h>
 
+#include <algorithm>
 #include <cmath>
 
 #include <armadillo>
 
+#include "parser/dataset_cache.h"
+#include "parser/dataset_stream.h"
 #include "util/ocrtypes.h"
+#include "util/serialize.h"
 
 namespace ocr {
 
@@ -15,10 +19,47 @@ namespace ocr {
  * A Principle Component Analysis (PCA) implementation.
  *
  * Defines an implementation of PCA with the ability to designate how the
- * projection is found and the reduced space.
+ * projection is found and the reduced space. The dataset, components and
+ * projections have the element type of the template; PCA works in doubles
+ * and FPCA in floats, while the number of dimensions is always selected in
+ * double precision.
+ *
+ * A solved PCA can be saved and restored, which skips solving again when
+ * the same dataset is reduced by a later run.
  */
-class PCA {
+template<typename eT>
+class BasicPCA : public Serializable {
 public:
+	/**
+	 * Enumeration of the ways of solving for the principle components
+	 *
+	 * SVD_SOLVER takes the singular value decomposition of the centered
+	 * dataset, while COVARIANCE_SOLVER accumulates the dxd scatter matrix of
+	 * the dataset with rank-k updates and takes its eigendecomposition, which
+	 * is much cheaper in time and memory when the number of entries n is
+	 * much larger than the number of dimensions d. AUTO_SOLVER uses the
+	 * covariance route when n >= kCovarianceRatio*d.
+	 *
+	 * RANDOMIZED_SOLVER computes only the leading components with the
+	 * randomized range finder of Halko, Martinsson and Tropp: the centered
+	 * dataset is applied to a Gaussian test matrix with a few extra columns,
+	 * refined by power iterations, and the SVD is taken of the dataset
+	 * projected onto the resulting range. It is much faster than the exact
+	 * solvers when the number of dimensions is small, but it needs the number
+	 * of dimensions in advance, so the other dimension select modes fall back
+	 * to AUTO_SOLVER.
+	 */
+	enum Solver {
+		AUTO_SOLVER,
+		SVD_SOLVER,
+		COVARIANCE_SOLVER,
+		RANDOMIZED_SOLVER
+	};
+
+	static const size_t kCovarianceRatio = 4; /// Minimum n/d for covariance
+	static const size_t kBlockSize = 1024; /// Columns centered at a time
+	static const size_t kRetainedOversampling = 10; /// Extra retained components
+
 	/**
 	 * Default constructor for PCA uses automatic determination of dimensions
 	 *
@@ -27,7 +68,7 @@ public:
 	 * determines the number of dimensions to retain based on analysis of the
 	 * amounnt of variability measured.
 	 */
-	PCA();
+	BasicPCA();
 
 	/**
 	 * Constructor for PCA providing a set number of reduced dimensions
@@ -38,7 +79,7 @@ public:
 	 * @param[in] num_reduced_dimensions number of dimensions to include in
 	 * reduced subspace
 	 */
-	PCA(int num_reduced_dimensions);
+	BasicPCA(int num_reduced_dimensions);
 
 	/**
 	 * Consutuctor for PCA providing percent variability
@@ -49,9 +90,9 @@ public:
 	 * @param[in] percent_variability percentage of original space's variability
 	 * contained in reduced subspace
 	 */
-	PCA(double percent_variability);
+	BasicPCA(double percent_variability);
 
-	~PCA() {}
+	~BasicPCA() {}
 
 	/**
 	 * Trains the classifier given a dataset and known labels for the set
@@ -60,10 +101,72 @@ public:
 	 * later be used to predict the values of unknown data. This method should
 	 * be run prior to any testing methods (including test, test_batch...)
 	 *
+	 * The covariance route centers the dataset one block of kBlockSize
+	 * columns at a time, so it never copies the whole dataset.
+	 *
 	 * @param[in] data_set nxm matrix with each entry in a column
 	 * @param[in] label_set mx1 vector of data_set labels
 	 */
-	void solve( const arma::mat &dataset );
+	void solve( const arma::Mat<eT> &dataset );
+
+	/**
+	 * Solve for the projection of a streamed dataset
+	 *
+	 * Accumulates the mean and scatter matrix of the dataset one batch at a
+	 * time and then takes the eigendecomposition of the scatter matrix, as
+	 * the covariance solver does. Only a batch
+	 * and two nxn matrices are held in memory, so the dataset may be larger
+	 * than memory. The stream is rewound before it is read.
+	 *
+	 * @param[in] stream stream of nxm dataset with each entry in a column
+	 */
+	void solve( BasicDatasetStream<eT> &stream );
+
+	/**
+	 * Update the projection with a batch of new entries
+	 *
+	 * Maintains the mean and a truncated singular value decomposition of the
+	 * entries seen so far (the incremental PCA of Ross et al.). Each update
+	 * takes the SVD of the retained components, weighted by their singular
+	 * values, stacked with the centered batch and a correction for the
+	 * change of mean. The projection is then selected from the retained
+	 * components as solve would. The result matches solve over every entry
+	 * seen as long as the retained components capture the discarded
+	 * spectrum, and exactly when every component is retained.
+	 *
+	 * Updates need a set number of dimensions or percent variability, as
+	 * the likelihood of the AUTO mode needs the whole spectrum. A call to
+	 * solve discards the entries seen by previous updates. With a set number
+	 * of dimensions, the projection stays empty until the retained
+	 * components cover that many dimensions, so early batches may hold
+	 * fewer entries than the number of dimensions.
+	 *
+	 * @param[in] batch nxm matrix of new entries with each entry in a column
+	 */
+	void update( const arma::Mat<eT> &batch );
+
+	/**
+	 * Update the projection with every batch of a stream
+	 *
+	 * @param[in] stream stream of new entries; it is rewound before it is read
+	 */
+	void update( BasicDatasetStream<eT> &stream );
+
+	/**
+	 * Set the number of components retained between updates
+	 *
+	 * @param[in] num_retained number of components (0 retains the number of
+	 *   dimensions plus kRetainedOversampling in NUM_DIMENSIONS mode, and
+	 *   every component otherwise)
+	 */
+	void set_retained_components(size_t num_retained);
+
+	/**
+	 * Returns the number of entries seen by update since the last solve
+	 *
+	 * @param[out] num_samples number of entries
+	 */
+	size_t get_num_samples();
 
 	/**
 	 * Determine the error rate for a given test set
@@ -79,7 +182,7 @@ public:
 	 *
 	 * @return fractional error rate
 	 */
-	arma::mat project( const arma::mat &mat, bool reverse = false );
+	arma::Mat<eT> project( const arma::Mat<eT> &mat, bool reverse = false );
 
 	/**
 	 * Set the PCA to solve for a specified percent variability
@@ -143,6 +246,88 @@ public:
 	 */
 	void set_auto_dimension();
 
+	/**
+	 * Set the method used to solve for the principle components
+	 *
+	 * @param[in] solver solver to use (AUTO_SOLVER selects by the shape of
+	 *   the dataset)
+	 */
+	void set_solver(Solver solver);
+
+	/**
+	 * Returns the method used to solve for the principle components
+	 *
+	 * @param[out] solver solver in use
+	 */
+	Solver get_solver();
+
+	/**
+	 * Set the parameters of the randomized solver
+	 *
+	 * @param[in] oversampling number of columns sampled beyond the number of
+	 *   dimensions (default 10)
+	 * @param[in] power_iterations number of power iterations, each of which
+	 *   sharpens the decay of the spectrum at the cost of two passes over the
+	 *   dataset (default 1)
+	 */
+	void set_randomized_parameters(size_t oversampling, size_t power_iterations);
+
+	/**
+	 * Measure the distance between the subspaces of two solutions
+	 *
+	 * Returns the sine of the largest principal angle between the subspaces
+	 * spanned by the two projections, which is 0 when they span the same
+	 * subspace and 1 when some direction of one is orthogonal to the other.
+	 * Comparing a randomized solution to an exact one reports the accuracy
+	 * of the randomized solver.
+	 *
+	 * @param[in] other solution over the same input dimensions
+	 *
+	 * @return sine of the largest principal angle (1 if the numbers of
+	 *   dimensions differ)
+	 */
+	double subspace_distance(const BasicPCA &other) const;
+
+	/**
+	 * Returns the matrix that left-multiplies entries to project them
+	 *
+	 * @param[out] projection dxn projection matrix of the last solve
+	 */
+	const arma::Mat<eT> &get_projection_matrix() const;
+
+	/**
+	 * Restore a previously solved projection
+	 *
+	 * Replaces the projection with a given matrix, such as one loaded from a
+	 * cache, so that entries can be projected without solving again. The
+	 * number of dimensions is set to the number of rows of the matrix.
+	 *
+	 * @param[in] projection dxn projection matrix
+	 */
+	void set_projection_matrix(const arma::Mat<eT> &projection);
+
+	/**
+	 * Save the options and the last solution to a stream
+	 *
+	 * Writes the dimension selection and solver options along with the
+	 * projection, mean, basis and singular values of the last solve.
+	 *
+	 * @param[in] ostream binary output stream
+	 *
+	 * @return true if the stream is still good after writing
+	 */
+	bool save( std::ostream &ostream ) const;
+
+	/**
+	 * Restore the options and the solution from a stream
+	 *
+	 * @param[in] istream binary stream written by save
+	 *
+	 * @return true if the PCA was restored, false (leaving it unchanged) if
+	 *   the data is corrupt or not a PCA of this element type
+	 */
+	bool load( std::istream &istream );
+
 private:
 	/**
 	 * Enumeration of different ways of determining PCA dimensions
@@ -159,10 +344,19 @@ private:
 		PERCENT_VARIABILITY
 	};
 
-	arma::mat projection_matrix_; /// Matrix containing left-multiply projection
+	arma::Mat<eT> projection_matrix_; /// Matrix containing left-multiply projection
 	uint32_t num_reduced_dimensions_; /// Number of dimensions
 	double percent_variability_; // Percent variability
 	Mode dimension_select_mode_; // Method of selecting number of dimensions
+	Solver solver_; /// Method of solving for the principle components
+	size_t oversampling_; /// Extra columns sampled by the randomized solver
+	size_t power_iterations_; /// Power iterations of the randomized solver
+	size_t num_retained_; /// Components retained between updates (0 = auto)
+	size_t num_samples_; /// Entries seen by update
+	arma::Col<eT> mean_; /// Mean of the entries seen by update
+	arma::Mat<eT> basis_; /// Retained left singular vectors of the entries
+	arma::Col<eT> singular_values_; /// Retained singular values of the entries
+	double total_scatter_; /// Sum of squared deviations of the entries
 
 	/**
 	 * Return number of dimensions using Minka's MLE
@@ -177,8 +371,58 @@ private:
 	size_t determine_dimensions(const arma::vec &eigenvalues,
 			const size_t n_samples);
 
+	/**
+	 * Merge a batch of entries into a running mean and scatter matrix
+	 *
+	 * Uses the pairwise update of Chan et al., which centers each batch on
+	 * its own mean and so avoids the cancellation of accumulating raw second
+	 * moments.
+	 *
+	 * @param[in,out] batch batch of entries, centered in place
+	 * @param[in,out] mean mean of the entries merged so far
+	 * @param[in,out] scatter scatter matrix of the entries merged so far
+	 * @param[in,out] num_samples number of entries merged so far
+	 */
+	static void accumulate_scatter(arma::Mat<eT> &batch, arma::Col<eT> &mean,
+			arma::Mat<eT> &scatter, size_t &num_samples);
+
+	/**
+	 * Solve for the leading components with the randomized range finder
+	 *
+	 * @param[in] dataset nxm matrix with each entry in a column
+	 */
+	void solve_randomized(const arma::Mat<eT> &dataset);
+
+	/**
+	 * Select the projection from the eigendecomposition of a scatter matrix
+	 *
+	 * @param[in] scatter scatter matrix of the centered dataset
+	 * @param[in] n_samples number of samples in dataset
+	 */
+	void solve_scatter(const arma::Mat<eT> &scatter, const size_t n_samples);
+
+	/**
+	 * Select the projection from the eigendecomposition of the dataset
+	 *
+	 * Determines the number of dimensions according to the dimension select
+	 * mode and stores the leading eigenvectors as the projection.
+	 *
+	 * @param[in] eigenvectors eigenvectors in columns, in descending order of
+	 *   eigenvalue
+	 * @param[in] eigenvalues eigenvalues in descending order
+	 * @param[in] n_samples number of samples in dataset
+	 * @param[in] total_variance sum of every eigenvalue, including those of a
+	 *   truncated spectrum
+	 */
+	void select_projection(const arma::Mat<eT> &eigenvectors,
+			const arma::Col<eT> &eigenvalues, const size_t n_samples,
+			const double total_variance);
+
 };
 
+typedef BasicPCA<double> PCA;
+typedef BasicPCA<float> FPCA;
+
 }
 
 #endif // OCR_UTIL_PRINCIPLE_COMPONENT_ANALYSIS_H_
\ No newline at end of file
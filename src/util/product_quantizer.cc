@@ -0,0 +1,137 @@
+#include "util/product_quantizer.h"
+
+ocr::ProductQuantizer::ProductQuantizer( uint32_t num_subspaces,
+	uint32_t num_centroids, uint32_t iterations ) {
+	if ( num_subspaces == 0 ) {
+		throw std::invalid_argument("num_subspaces must be positive");
+	}
+	if ( num_centroids == 0 || num_centroids > 256 ) {
+		throw std::invalid_argument("num_centroids must be in [1, 256]");
+	}
+
+	this->num_subspaces_ = num_subspaces;
+	this->num_centroids_ = num_centroids;
+	this->iterations_ = iterations;
+}
+
+void ocr::ProductQuantizer::train( const arma::mat &dataset ) {
+	if ( dataset.n_rows < this->num_subspaces_ ) {
+		throw std::invalid_argument("fewer dimensions than subspaces");
+	}
+
+	this->bounds_ = subspace_bounds(dataset.n_rows);
+	this->codebooks_.clear();
+	this->codebook_norms_.clear();
+
+	const arma::uword k = std::min<arma::uword>(this->num_centroids_,
+		dataset.n_cols);
+	std::mt19937 generator = std::mt19937(0);
+
+	for ( uint32_t s = 0; s < this->num_subspaces_; s++ ) {
+		const arma::mat subspace =
+			dataset.rows(this->bounds_[s], this->bounds_[s+1]-1);
+
+		// Initialize with distinct random entries
+		std::vector<arma::uword> order(dataset.n_cols);
+		for ( arma::uword i = 0; i < order.size(); i++ ) {
+			order[i] = i;
+		}
+		std::shuffle(order.begin(), order.end(), generator);
+		arma::mat centroids = subspace.cols(
+			arma::uvec(std::vector<arma::uword>(order.begin(), order.begin()+k)));
+
+		arma::uvec assignments = arma::uvec(dataset.n_cols);
+		arma::vec errors = arma::vec(dataset.n_cols);
+		const arma::rowvec point_norms = arma::sum(arma::square(subspace), 0);
+		for ( uint32_t iteration = 0; iteration < this->iterations_; iteration++ ) {
+			// Assign every entry to its nearest centroid, with the distances
+			// expanded so that the bulk of the work is a matrix product
+			const arma::vec centroid_norms = arma::sum(arma::square(centroids), 0).t();
+			const arma::mat cross = centroids.t() * subspace;
+			for ( arma::uword i = 0; i < subspace.n_cols; i++ ) {
+				arma::vec distances = centroid_norms - 2*cross.col(i);
+				assignments[i] = distances.index_min();
+				errors[i] = distances[assignments[i]] + point_norms[i];
+			}
+
+			// Move each centroid to the mean of its entries. A centroid that
+			// lost every entry is moved onto the worst represented entry.
+			arma::mat sums = arma::zeros<arma::mat>(subspace.n_rows, k);
+			arma::uvec counts = arma::zeros<arma::uvec>(k);
+			for ( arma::uword i = 0; i < subspace.n_cols; i++ ) {
+				sums.col(assignments[i]) += subspace.col(i);
+				counts[assignments[i]]++;
+			}
+			for ( arma::uword c = 0; c < k; c++ ) {
+				if ( counts[c] > 0 ) {
+					centroids.col(c) = sums.col(c)/counts[c];
+					continue;
+				}
+				arma::uword worst = errors.index_max();
+				centroids.col(c) = subspace.col(worst);
+				errors[worst] = 0;
+			}
+		}
+
+		this->codebooks_.push_back(centroids);
+		this->codebook_norms_.push_back(arma::sum(arma::square(centroids), 0));
+	}
+}
+
+arma::Mat<uint8_t> ocr::ProductQuantizer::encode( const arma::mat &dataset ) const {
+	arma::Mat<uint8_t> codes = arma::Mat<uint8_t>(this->num_subspaces_,
+		dataset.n_cols);
+
+	for ( uint32_t s = 0; s < this->num_subspaces_; s++ ) {
+		const arma::mat cross = this->codebooks_[s].t()
+			* dataset.rows(this->bounds_[s], this->bounds_[s+1]-1);
+		const arma::vec norms = this->codebook_norms_[s].t();
+		for ( arma::uword i = 0; i < dataset.n_cols; i++ ) {
+			arma::vec distances = norms - 2*cross.col(i);
+			codes.at(s, i) = (uint8_t)distances.index_min();
+		}
+	}
+
+	return codes;
+}
+
+arma::mat ocr::ProductQuantizer::decode( const arma::Mat<uint8_t> &codes ) const {
+	arma::mat dataset = arma::mat(this->bounds_[this->num_subspaces_],
+		codes.n_cols);
+
+	for ( arma::uword i = 0; i < codes.n_cols; i++ ) {
+		for ( uint32_t s = 0; s < this->num_subspaces_; s++ ) {
+			dataset.col(i).rows(this->bounds_[s], this->bounds_[s+1]-1) =
+				this->codebooks_[s].col(codes.at(s, i));
+		}
+	}
+
+	return dataset;
+}
+
+void ocr::ProductQuantizer::distance_table( const arma::vec &query,
+	arma::mat &table ) const {
+
+	table.set_size(this->num_centroids_, this->num_subspaces_);
+	table.fill(DBL_MAX);
+
+	for ( uint32_t s = 0; s < this->num_subspaces_; s++ ) {
+		const arma::vec part = query.rows(this->bounds_[s], this->bounds_[s+1]-1);
+		const arma::mat &centroids = this->codebooks_[s];
+		table.col(s).head(centroids.n_cols) =
+			(this->codebook_norms_[s] - 2*part.t()*centroids).t()
+			+ arma::dot(part, part);
+	}
+}
+
+uint32_t ocr::ProductQuantizer::get_num_subspaces() const {
+	return this->num_subspaces_;
+}
+
+arma::uvec ocr::ProductQuantizer::subspace_bounds( arma::uword num_rows ) const {
+	arma::uvec bounds = arma::uvec(this->num_subspaces_ + 1);
+	for ( uint32_t s = 0; s <= this->num_subspaces_; s++ ) {
+		bounds[s] = s*num_rows/this->num_subspaces_;
+	}
+	return bounds;
+}
@@ -0,0 +1,116 @@
+#ifndef OCR_UTIL_PRODUCT_QUANTIZER_H_
+#define OCR_UTIL_PRODUCT_QUANTIZER_H_
+
+#include <float.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <armadillo>
+
+namespace ocr {
+
+/**
+ * A product quantizer compressing vectors into short codes.
+ *
+ * Splits the dimensions of the vectors into contiguous subspaces and learns
+ * a codebook of centroids for each subspace with k-means. A vector is then
+ * encoded as the index of the nearest centroid in every subspace, using one
+ * byte per subspace. The squared Euclidean distance between an uncompressed
+ * query and an encoded vector is approximated from a table of the distances
+ * between the query and every centroid (asymmetric distance computation,
+ * Jegou et al.).
+ */
+class ProductQuantizer {
+public:
+	/**
+	 * Constructor for the product quantizer
+	 *
+	 * @param[in] num_subspaces number of subspaces (bytes per code)
+	 * @param[in] num_centroids number of centroids per subspace (at most 256)
+	 * @param[in] iterations number of k-means iterations
+	 */
+	ProductQuantizer( uint32_t num_subspaces = 8, uint32_t num_centroids = 256,
+					  uint32_t iterations = 25 );
+	~ProductQuantizer() {}
+
+	/**
+	 * Learn the codebooks from a dataset
+	 *
+	 * Runs k-means independently on each subspace of the dataset. If the
+	 * dataset has fewer entries than centroids, every entry becomes a
+	 * centroid.
+	 *
+	 * @param[in] dataset nxm matrix with each entry in a column
+	 */
+	void train( const arma::mat &dataset );
+
+	/**
+	 * Encode vectors into codes
+	 *
+	 * @param[in] dataset nxm matrix with each entry in a column
+	 *
+	 * @return sxm matrix where each column holds the code of an entry
+	 */
+	arma::Mat<uint8_t> encode( const arma::mat &dataset ) const;
+
+	/**
+	 * Reconstruct approximate vectors from codes
+	 *
+	 * @param[in] codes sxm matrix where each column holds a code
+	 *
+	 * @return nxm matrix of the concatenated centroids of each code
+	 */
+	arma::mat decode( const arma::Mat<uint8_t> &codes ) const;
+
+	/**
+	 * Compute the distance table of a query
+	 *
+	 * @param[in] query nx1 uncompressed vector
+	 * @param[out] table kxs matrix of squared distances between the query and
+	 *   each centroid of each subspace
+	 */
+	void distance_table( const arma::vec &query, arma::mat &table ) const;
+
+	/**
+	 * Approximate squared Euclidean distance to an encoded vector
+	 *
+	 * @param[in] table distance table of the query
+	 * @param[in] code pointer to the s bytes of a code
+	 *
+	 * @return sum of the table entries selected by the code
+	 */
+	double asymmetric_distance( const arma::mat &table, const uint8_t *code ) const {
+		const double *entries = table.memptr();
+		const arma::uword k = table.n_rows;
+		double distance = 0.;
+		for ( arma::uword j = 0; j < table.n_cols; j++ ) {
+			distance += entries[j*k + code[j]];
+		}
+		return distance;
+	}
+
+	/**
+	 * Returns the number of bytes per code
+	 */
+	uint32_t get_num_subspaces() const;
+
+private:
+	/**
+	 * Returns the first row of each subspace, followed by the row count
+	 */
+	arma::uvec subspace_bounds( arma::uword num_rows ) const;
+
+	uint32_t num_subspaces_; /// Number of subspaces
+	uint32_t num_centroids_; /// Requested centroids per subspace
+	uint32_t iterations_; /// k-means iterations
+	arma::uvec bounds_; /// First row of each subspace and the row count
+	std::vector<arma::mat> codebooks_; /// Centroids (in columns) per subspace
+	std::vector<arma::rowvec> codebook_norms_; /// Squared centroid norms
+};
+
+}
+
+#endif // OCR_UTIL_PRODUCT_QUANTIZER_H_
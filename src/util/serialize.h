@@ -1,10 +1,20 @@
 #ifndef OCR_UTIL_SERIALIZE_H_
 #define OCR_UTIL_SERIALIZE_H_
 
+#include <fstream>
 #include <iostream>
+#include <string>
 
 namespace ocr {
 
+/**
+ * Defines an interface for objects that can be saved and restored.
+ *
+ * Models are written in the binary format of DatasetCache: a header naming
+ * the model and holding a checksum, and each matrix of the model starting
+ * on a 64-byte boundary. Restoring from a file may map it rather than read
+ * it, in which case the large matrices of the model are views of the file.
+ */
 class Serializable {
 
 protected:
@@ -27,9 +37,11 @@ public:
 	 * can later be read and used to recreate all necessary information to
 	 * restore the class to its original state.
 	 *
-	 * @param[in] filename std::ostream stream to write save data
+	 * @param[in] ostream binary stream to write save data
+	 *
+	 * @return true if the stream is still good after writing
 	 */
-	 virtual void save( const std::ostream &ostream ) = 0;
+	virtual bool save( std::ostream &ostream ) const = 0;
 
 	/**
 	 * Deserialization routine
@@ -37,11 +49,42 @@ public:
 	 * Loads all the required information from a stream to restore the class to
 	 * a previously created state that has been saved using the save routine.
 	 * The restored class should be identical in state to the previously saved
-	 * class.
+	 * class. The object is left unchanged if the data is not a valid save
+	 * of the class.
+	 *
+	 * @param[in] istream binary stream to load data from
+	 *
+	 * @return true if the object was restored
+	 */
+	virtual bool load( std::istream &istream ) = 0;
+
+	/**
+	 * Serialize the class to a file
+	 *
+	 * @param[in] filename name of the file to write
+	 *
+	 * @return true if the file was written
+	 */
+	bool save_file( const std::string &filename ) const {
+		std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+		return save(file) && static_cast<bool>(file.flush());
+	}
+
+	/**
+	 * Deserialize the class from a file
+	 *
+	 * Reads the file through load by default. Classes holding large
+	 * matrices override this to map the file instead, so that restoring
+	 * them costs little more than checking the checksum.
+	 *
+	 * @param[in] filename name of the file to read
 	 *
-	 * @param[in] filename std::istream stream to load data from
+	 * @return true if the object was restored
 	 */
-	virtual void load( const std::istream &ostream ) = 0;
+	virtual bool load_file( const std::string &filename ) {
+		std::ifstream file(filename, std::ios::binary);
+		return file && load(file);
+	}
 
 };
 
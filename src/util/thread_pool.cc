@@ -0,0 +1,42 @@
+#include "util/thread_pool.h"
+
+#include "util/parallel.h"
+
+ocr::utilities::ThreadPool::ThreadPool( size_t num_threads ) {
+	this->stopping_ = false;
+
+	num_threads = resolve_threads(num_threads);
+	for ( size_t t = 0; t < num_threads; t++ ) {
+		this->workers_.push_back(std::thread(&ThreadPool::run, this));
+	}
+}
+
+ocr::utilities::ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		this->stopping_ = true;
+	}
+	this->ready_.notify_all();
+
+	for ( auto &worker : this->workers_ ) {
+		worker.join();
+	}
+}
+
+void ocr::utilities::ThreadPool::run() {
+	while ( true ) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(this->mutex_);
+			this->ready_.wait(lock, [this]() {
+				return this->stopping_ || !this->tasks_.empty();
+			});
+			if ( this->tasks_.empty() ) {
+				return;
+			}
+			task = std::move(this->tasks_.front());
+			this->tasks_.pop();
+		}
+		task();
+	}
+}
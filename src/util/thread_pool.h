@@ -0,0 +1,83 @@
+#ifndef OCR_UTIL_THREAD_POOL_H_
+#define OCR_UTIL_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace ocr {
+	namespace utilities {
+		/**
+		 * A fixed set of worker threads executing queued tasks
+		 *
+		 * Tasks are executed in the order they are submitted by the first
+		 * available worker, and each submission returns a future holding the
+		 * result (or exception) of its task. Destroying the pool finishes
+		 * every queued task before joining the workers.
+		 */
+		class ThreadPool {
+		public:
+			/**
+			 * Start the worker threads
+			 *
+			 * @param[in] num_threads number of worker threads (0 = all cores)
+			 */
+			explicit ThreadPool( size_t num_threads = 0 );
+			~ThreadPool();
+
+			ThreadPool( const ThreadPool& ) = delete;
+			ThreadPool &operator=( const ThreadPool& ) = delete;
+
+			/**
+			 * Queue a task for execution
+			 *
+			 * @param[in] task callable taking no arguments
+			 *
+			 * @return future holding the value returned by the task
+			 */
+			template<typename Function>
+			std::future<typename std::result_of<Function()>::type>
+			submit( Function task ) {
+				typedef typename std::result_of<Function()>::type Result;
+
+				// std::function requires a copyable target, so the task is
+				// shared rather than moved into the queue
+				auto packaged = std::make_shared<std::packaged_task<Result()>>(task);
+				std::future<Result> result = packaged->get_future();
+				{
+					std::lock_guard<std::mutex> lock(this->mutex_);
+					this->tasks_.push([packaged]() { (*packaged)(); });
+				}
+				this->ready_.notify_one();
+				return result;
+			}
+
+			/**
+			 * Returns the number of worker threads
+			 */
+			size_t size() const {
+				return this->workers_.size();
+			}
+
+		private:
+			/**
+			 * Execute queued tasks until the pool is destroyed
+			 */
+			void run();
+
+			std::vector<std::thread> workers_; /// Worker threads
+			std::queue<std::function<void()>> tasks_; /// Queued tasks
+			std::mutex mutex_; /// Guards tasks_ and stopping_
+			std::condition_variable ready_; /// Signals a task or shutdown
+			bool stopping_; /// Whether the pool is being destroyed
+		};
+	}
+}
+
+#endif // OCR_UTIL_THREAD_POOL_H_
@@ -0,0 +1,81 @@
+#include "src/classifier/hnsw.h"
+
+#include <exception>
+
+#include <armadillo>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+namespace ocr {
+	class HNSWTests : public testing::Test {
+	public:
+		void SetUp() {
+			arma::arma_rng::set_seed(7);
+			training_set = arma::randn<arma::mat>(8, 3000);
+			training_labels =
+				arma::randi<arma::Col<label_t>>(3000, arma::distr_param(0, 9));
+			test_set = arma::randn<arma::mat>(8, 200);
+		}
+
+		void TearDown() {
+
+		}
+
+		/**
+		 * Fraction of queries whose nearest neighbor is found exactly
+		 */
+		double recall(ocr::HNSW &hnsw) {
+			size_t found = 0;
+			for ( arma::uword q = 0; q < test_set.n_cols; q++ ) {
+				arma::rowvec distances = arma::sum(arma::square(
+					training_set.each_col() - test_set.col(q)), 0);
+				std::vector<Neighbor> neighbors =
+					hnsw.nearest_neighbors(test_set.col(q));
+				found += ( neighbors[0].index == distances.index_min() );
+			}
+			return 1.0*found/test_set.n_cols;
+		}
+
+		arma::mat training_set;
+		arma::Col<label_t> training_labels;
+		arma::mat test_set;
+	};
+
+	TEST_F(HNSWTests, Constructor_Empty_Valid) {
+		EXPECT_NO_THROW({ocr::HNSW();});
+	}
+
+	TEST_F(HNSWTests, Constructor_InvalidParams_Invalid) {
+		EXPECT_THROW({ocr::HNSW(new PNorm(), 0);}, std::invalid_argument);
+		EXPECT_THROW({ocr::HNSW(new PNorm(), 1, 1);}, std::invalid_argument);
+	}
+
+	TEST_F(HNSWTests, NearestNeighbors_HighRecall) {
+		ocr::HNSW hnsw(new PNorm(2), 5, 16, 100, 100);
+		hnsw.train(training_set, training_labels);
+
+		EXPECT_LE(0.95, recall(hnsw));
+
+		std::vector<Neighbor> neighbors = hnsw.nearest_neighbors(test_set.col(0));
+		EXPECT_EQ(5, neighbors.size());
+		for ( size_t i = 1; i < neighbors.size(); i++ ) {
+			EXPECT_LE(neighbors[i-1].distance, neighbors[i].distance);
+		}
+	}
+
+	TEST_F(HNSWTests, Train_MultiThreaded_HighRecall) {
+		ocr::HNSW hnsw(new PNorm(2), 1, 16, 100, 100);
+		hnsw.set_num_threads(4);
+		hnsw.train(training_set, training_labels);
+
+		EXPECT_LE(0.95, recall(hnsw));
+	}
+
+	TEST_F(HNSWTests, Validate_TrainingSet_Exact) {
+		ocr::HNSW hnsw;
+		hnsw.train(training_set, training_labels);
+		EXPECT_EQ(0, hnsw.validate(training_set, training_labels));
+	}
+
+}
@@ -0,0 +1,135 @@
+#include "src/classifier/k_nearest_neighbor.h"
+
+#include <exception>
+
+#include <armadillo>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "src/classifier/nearest_neighbor.h"
+
+namespace ocr {
+	class KNearestNeighborTests : public testing::Test {
+	public:
+		void SetUp() {
+			labels = {0, 1, 1, 2, 2};
+		}
+
+		void TearDown() {
+
+		}
+
+		std::vector<Neighbor> neighbors( std::vector<double> distances ) {
+			std::vector<Neighbor> result;
+			for ( size_t i = 0; i < distances.size(); i++ ) {
+				result.push_back(Neighbor{distances[i], i});
+			}
+			return result;
+		}
+
+		arma::Col<label_t> labels;
+	};
+
+	TEST_F(KNearestNeighborTests, Constructor_Empty_Valid) {
+		EXPECT_NO_THROW({ocr::KNearestNeighbor();});
+	}
+
+	TEST_F(KNearestNeighborTests, Constructor_ZeroK_Invalid) {
+		EXPECT_THROW({ocr::KNearestNeighbor(0);}, std::invalid_argument);
+	}
+
+	TEST_F(KNearestNeighborTests, MajorityVote_Tie_NearestTiedLabel) {
+		// Labels 1 and 2 tie; label 1 holds the nearer neighbor
+		EXPECT_EQ(1, majority_vote(neighbors({1, 2, 3, 4, 5}), labels));
+		EXPECT_EQ(0, majority_vote(neighbors({1}), labels));
+	}
+
+	TEST_F(KNearestNeighborTests, WeightedVote_CloseNeighbor_Outweighs) {
+		EXPECT_EQ(0, weighted_vote(neighbors({0.1, 1, 1, 1, 1}), labels));
+		EXPECT_EQ(2, weighted_vote(neighbors({1, 1, 1, 0.5, 0.5}), labels));
+		EXPECT_EQ(2, weighted_vote(neighbors({1e-9, 1, 1, 0, 1}), labels));
+	}
+
+	TEST_F(KNearestNeighborTests, TieBreakVote_Tie_ShrinksNeighborhood) {
+		// Dropping the farthest neighbor (label 2) leaves label 1 ahead
+		EXPECT_EQ(1, tie_break_vote(neighbors({1, 2, 3, 4, 5}), labels));
+		arma::Col<label_t> alternating = {2, 1, 1, 2};
+		// 2-2 tie, then 1 leads among the nearest three
+		EXPECT_EQ(1, tie_break_vote(neighbors({1, 2, 3, 4}), alternating));
+		// 1-1 tie down to the nearest neighbor
+		EXPECT_EQ(2, tie_break_vote(neighbors({1, 2}), alternating));
+	}
+
+	TEST_F(KNearestNeighborTests, Vote_NoNeighbors_Invalid) {
+		for ( VotingRule rule : {MAJORITY, DISTANCE_WEIGHTED, TIE_BREAK} ) {
+			EXPECT_THROW({vote(neighbors({}), labels, rule);}, std::invalid_argument);
+		}
+	}
+
+	TEST_F(KNearestNeighborTests, Predict_EmptyTrainingSet_Invalid) {
+		ocr::KNearestNeighbor knn = ocr::KNearestNeighbor(3);
+		knn.train(arma::mat(4, 0), arma::Col<label_t>());
+		EXPECT_THROW({knn.predict(arma::zeros<arma::vec>(4));},
+			std::invalid_argument);
+		EXPECT_THROW({knn.test(arma::zeros<arma::mat>(4, 2));},
+			std::invalid_argument);
+	}
+
+	TEST_F(KNearestNeighborTests, LabelShare_Label_FractionAndNearest) {
+		size_t nearest;
+		EXPECT_DOUBLE_EQ(0.4, label_share(neighbors({1, 2, 3, 4, 5}), labels,
+			2, nearest));
+		EXPECT_EQ(3u, nearest);
+		EXPECT_DOUBLE_EQ(0, label_share(neighbors({1}), labels, 1, nearest));
+		EXPECT_EQ(1u, nearest);
+	}
+
+	TEST_F(KNearestNeighborTests, Test_OneNeighbor_MatchesNearestNeighbor) {
+		arma::arma_rng::set_seed(9);
+		arma::mat training_set = arma::randu<arma::mat>(5, 800);
+		arma::Col<label_t> training_labels =
+			arma::randi<arma::Col<label_t>>(800, arma::distr_param(0, 9));
+		arma::mat test_set = arma::randu<arma::mat>(5, 100);
+
+		ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(1));
+		nn.train(training_set, training_labels);
+		ocr::KNearestNeighbor knn = ocr::KNearestNeighbor(1, new PNorm(1));
+		knn.train(training_set, training_labels);
+
+		arma::Col<label_t> expected, actual;
+		nn.validate(test_set, training_labels.head(100), &expected);
+		knn.validate(test_set, training_labels.head(100), &actual);
+		EXPECT_TRUE(arma::all(expected == actual));
+	}
+
+	TEST_F(KNearestNeighborTests, NearestNeighbors_TrueDistances) {
+		arma::mat training_set = {{0, 3, 1, 10}, {0, 4, 1, 10}};
+		ocr::KNearestNeighbor knn = ocr::KNearestNeighbor(2, new PNorm(2));
+		knn.train(training_set, arma::Col<label_t>({0, 1, 2, 3}));
+
+		std::vector<Neighbor> result = knn.nearest_neighbors(arma::vec({0, 0}));
+		ASSERT_EQ(2, result.size());
+		EXPECT_EQ(0, result[0].index);
+		EXPECT_EQ(2, result[1].index);
+		EXPECT_DOUBLE_EQ(std::sqrt(2.), result[1].distance);
+	}
+
+	TEST_F(KNearestNeighborTests, TestBatch_Scores_NearestHolderAndShare) {
+		arma::mat training_set = {{0, 1, 2, 10, 11}, {0, 0, 0, 0, 0}};
+		ocr::KNearestNeighbor knn = ocr::KNearestNeighbor(3, new PNorm(2));
+		knn.train(training_set, arma::Col<label_t>({0, 1, 1, 2, 2}));
+
+		arma::Col<label_t> result;
+		arma::vec distances;
+		arma::vec confidence;
+		knn.test_batch(arma::mat({{0.2, 10.4}, {0, 0}}), result, &distances,
+			&confidence);
+		EXPECT_EQ(1, result[0]);
+		EXPECT_EQ(2, result[1]);
+		EXPECT_NEAR(0.8, distances[0], 1e-12);
+		EXPECT_NEAR(0.4, distances[1], 1e-12);
+		EXPECT_DOUBLE_EQ(2./3, confidence[0]);
+		EXPECT_DOUBLE_EQ(2./3, confidence[1]);
+	}
+}
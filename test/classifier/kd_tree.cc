@@ -0,0 +1,119 @@
+#include "src/classifier/kd_tree.h"
+
+#include <exception>
+
+#include <armadillo>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "src/classifier/nearest_neighbor.h"
+
+namespace ocr {
+	class KDTreeTests : public testing::Test {
+	public:
+		void SetUp() {
+			arma::arma_rng::set_seed(5);
+			training_set = arma::randn<arma::mat>(4, 2000);
+			training_labels =
+				arma::randi<arma::Col<label_t>>(2000, arma::distr_param(0, 9));
+			test_set = arma::randn<arma::mat>(4, 200);
+		}
+
+		void TearDown() {
+
+		}
+
+		arma::mat training_set;
+		arma::Col<label_t> training_labels;
+		arma::mat test_set;
+	};
+
+	TEST_F(KDTreeTests, Constructor_Empty_Valid) {
+		EXPECT_NO_THROW({ocr::KDTree();});
+	}
+
+	TEST_F(KDTreeTests, Constructor_ZeroK_Invalid) {
+		EXPECT_THROW({ocr::KDTree(0);}, std::invalid_argument);
+	}
+
+	TEST_F(KDTreeTests, Test_OneNeighbor_MatchesNearestNeighbor) {
+		for ( uint32_t p = 1; p <= 3; p++ ) {
+			ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(p));
+			nn.set_batched(false);
+			nn.train(training_set, training_labels);
+
+			ocr::KDTree tree = ocr::KDTree(1, p);
+			tree.train(training_set, training_labels);
+
+			arma::Col<label_t> expected, actual;
+			nn.validate(test_set, training_labels.head(200), &expected);
+			tree.validate(test_set, training_labels.head(200), &actual);
+			EXPECT_TRUE(arma::all(expected == actual));
+		}
+	}
+
+	TEST_F(KDTreeTests, TestBatch_OneNeighbor_MatchesNearestNeighborScores) {
+		for ( uint32_t p = 1; p <= 3; p++ ) {
+			ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(p));
+			nn.set_batched(false);
+			nn.train(training_set, training_labels);
+
+			ocr::KDTree tree = ocr::KDTree(1, p);
+			tree.train(training_set, training_labels);
+
+			arma::Col<label_t> expected, actual;
+			arma::vec expected_distances, actual_distances;
+			arma::vec confidence;
+			nn.test_batch(test_set, expected, &expected_distances);
+			tree.test_batch(test_set, actual, &actual_distances, &confidence);
+			EXPECT_TRUE(arma::all(expected == actual));
+			EXPECT_TRUE(arma::approx_equal(expected_distances, actual_distances,
+				"absdiff", 1e-9));
+			EXPECT_TRUE(arma::all(confidence == 1));
+		}
+	}
+
+	TEST_F(KDTreeTests, Train_Moved_SamePredictions) {
+		ocr::KDTree tree = ocr::KDTree(3);
+		tree.train(training_set, training_labels);
+
+		ocr::KDTree moved = ocr::KDTree(3);
+		moved.train(arma::mat(training_set), arma::Col<label_t>(training_labels));
+		EXPECT_TRUE(arma::all(tree.test(test_set) == moved.test(test_set)));
+	}
+
+	TEST_F(KDTreeTests, Predict_EmptyTrainingSet_Invalid) {
+		ocr::KDTree tree = ocr::KDTree(3);
+		tree.train(arma::mat(4, 0), arma::Col<label_t>());
+		EXPECT_THROW({tree.predict(test_set.col(0));}, std::invalid_argument);
+	}
+
+	TEST_F(KDTreeTests, NearestNeighbors_MatchesSortedDistances) {
+		ocr::KDTree tree = ocr::KDTree(7);
+		tree.train(training_set, training_labels);
+
+		for ( arma::uword q = 0; q < test_set.n_cols; q++ ) {
+			arma::vec distances = arma::sum(arma::square(
+				training_set.each_col() - test_set.col(q)), 0).t();
+			arma::uvec expected = arma::sort_index(distances);
+
+			std::vector<Neighbor> neighbors = tree.nearest_neighbors(test_set.col(q));
+			ASSERT_EQ(7, neighbors.size());
+			for ( size_t i = 0; i < neighbors.size(); i++ ) {
+				EXPECT_EQ(expected[i], neighbors[i].index);
+				EXPECT_NEAR(distances[expected[i]], neighbors[i].distance, 1e-9);
+			}
+		}
+	}
+
+	TEST_F(KDTreeTests, Validate_DuplicateEntries_Valid) {
+		arma::mat duplicates = arma::ones<arma::mat>(3, 100);
+		arma::Col<label_t> labels = arma::zeros<arma::Col<label_t>>(100);
+
+		ocr::KDTree tree = ocr::KDTree(3);
+		tree.train(duplicates, labels);
+		EXPECT_EQ(0, tree.validate(duplicates, labels));
+	}
+
+}
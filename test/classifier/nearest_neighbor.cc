@@ -1,22 +1,50 @@
 #include "src/classifier/nearest_neighbor.h"
 
+#include <cstdio>
 #include <exception>
+#include <sstream>
+#include <string>
+#include <utility>
 
 #include <armadillo>
 
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
 
+#include "src/util/principle_component_analysis.h"
+
 namespace ocr {
 	class NearestNeighborTests : public testing::Test {
 	public:
 		void SetUp() {
+			model_filename = "/tmp/ocr_nearest_neighbor.model";
 
+			arma::arma_rng::set_seed(11);
+			training_set = arma::randu<arma::mat>(9, 300);
+			training_labels =
+				arma::randi<arma::Col<label_t>>(300, arma::distr_param(0, 9));
+			test_set = arma::randu<arma::mat>(9, 60);
 		}
 
 		void TearDown() {
+			std::remove(model_filename.c_str());
+		}
 
+		/**
+		 * Returns the predictions of a classifier on the test set
+		 */
+		template<typename eT>
+		arma::Col<label_t> predictions( BasicClassifier<eT> &classifier ) {
+			arma::Col<label_t> labels;
+			classifier.validate(arma::conv_to<arma::Mat<eT>>::from(test_set),
+				arma::zeros<arma::Col<label_t>>(test_set.n_cols), &labels);
+			return labels;
 		}
+
+		std::string model_filename;
+		arma::mat training_set;
+		arma::Col<label_t> training_labels;
+		arma::mat test_set;
 	};
 
 	TEST_F(NearestNeighborTests, Constructor_Empty_Valid) {
@@ -24,11 +52,300 @@ namespace ocr {
 	}
 
 	TEST_F(NearestNeighborTests, Constructor_PNorm_Valid) {
-		EXPECT_NO_THROW({ocr::NearestNeighbor(PNorm());});
+		EXPECT_NO_THROW({ocr::NearestNeighbor nn(new PNorm());});
 	}
 
 	TEST_F(NearestNeighborTests, Train_) {
 		ocr::NearestNeighbor nn = ocr::NearestNeighbor();
 	}
 
-}
\ No newline at end of file
+	TEST_F(NearestNeighborTests, Test_Batched_MatchesLinearScan) {
+		arma::arma_rng::set_seed(1);
+		arma::mat training_set = arma::randu<arma::mat>(8, 500);
+		arma::Col<label_t> training_labels =
+			arma::randi<arma::Col<label_t>>(500, arma::distr_param(0, 9));
+		arma::mat test_set = arma::randu<arma::mat>(8, 150);
+
+		ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(2));
+		nn.train(training_set, training_labels);
+
+		nn.set_batched(false);
+		arma::Col<label_t> expected;
+		arma::vec expected_distances;
+		arma::vec expected_confidence;
+		nn.test_batch(test_set, expected, &expected_distances, &expected_confidence);
+		nn.set_batched(true);
+		arma::Col<label_t> actual;
+		arma::vec actual_distances;
+		arma::vec actual_confidence;
+		nn.test_batch(test_set, actual, &actual_distances, &actual_confidence);
+
+		EXPECT_TRUE(arma::all(expected == actual));
+		EXPECT_TRUE(arma::all(actual == nn.test(test_set)));
+		EXPECT_TRUE(arma::approx_equal(expected_distances, actual_distances,
+			"absdiff", 1e-12));
+		EXPECT_TRUE(arma::approx_equal(expected_confidence, actual_confidence,
+			"absdiff", 1e-12));
+	}
+
+	TEST_F(NearestNeighborTests, TestBatch_Scores_MatchBruteForce) {
+		for ( uint32_t p = 1; p <= 2; p++ ) {
+			ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(p));
+			nn.train(training_set, training_labels);
+
+			arma::Col<label_t> labels;
+			arma::vec distances;
+			arma::vec confidence;
+			nn.test_batch(test_set, labels, &distances, &confidence);
+			ASSERT_EQ(test_set.n_cols, confidence.n_elem);
+
+			for ( arma::uword i = 0; i < test_set.n_cols; i++ ) {
+				arma::vec all_distances = arma::vec(training_set.n_cols);
+				for ( arma::uword j = 0; j < training_set.n_cols; j++ ) {
+					all_distances[j] = arma::norm(test_set.col(i)
+						- training_set.col(j), p);
+				}
+				const double nearest = all_distances.min();
+				const double other = arma::vec(all_distances.elem(
+					arma::find(training_labels != labels[i]))).min();
+				EXPECT_NEAR(nearest, distances[i], 1e-12);
+				EXPECT_NEAR(other/(nearest + other), confidence[i], 1e-12);
+				EXPECT_GE(confidence[i], 0.5);
+			}
+		}
+	}
+
+	TEST_F(NearestNeighborTests, TestBatch_SingleLabel_FullConfidence) {
+		ocr::NearestNeighbor nn;
+		nn.train(training_set, arma::zeros<arma::Col<label_t>>(training_set.n_cols));
+
+		arma::Col<label_t> labels;
+		arma::vec confidence;
+		nn.test_batch(test_set, labels, nullptr, &confidence);
+		EXPECT_TRUE(arma::all(labels == 0));
+		EXPECT_TRUE(arma::all(confidence == 1));
+	}
+
+	TEST_F(NearestNeighborTests, Validate_Batched_TrainingSetIsExact) {
+		arma::arma_rng::set_seed(2);
+		arma::mat training_set = arma::randu<arma::mat>(5, 5000);
+		arma::Col<label_t> training_labels =
+			arma::regspace<arma::Col<label_t>>(0, 4999);
+
+		ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(2));
+		nn.train(training_set, training_labels);
+		EXPECT_EQ(0, nn.validate(training_set, training_labels));
+	}
+
+	TEST_F(NearestNeighborTests, Test_MultiThreaded_MatchesSingleThreaded) {
+		arma::arma_rng::set_seed(3);
+		arma::mat training_set = arma::randu<arma::mat>(6, 700);
+		arma::Col<label_t> training_labels =
+			arma::randi<arma::Col<label_t>>(700, arma::distr_param(0, 9));
+		arma::mat test_set = arma::randu<arma::mat>(6, 333);
+
+		for ( uint32_t p = 1; p <= 2; p++ ) {
+			ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(p));
+			nn.train(training_set, training_labels);
+
+			arma::Col<label_t> expected, actual;
+			double expected_error = nn.validate(test_set, training_labels.head(333), &expected);
+			nn.set_num_threads(4);
+			double actual_error = nn.validate(test_set, training_labels.head(333), &actual);
+
+			EXPECT_EQ(expected_error, actual_error);
+			EXPECT_TRUE(arma::all(expected == actual));
+		}
+	}
+
+	TEST_F(NearestNeighborTests, Test_EarlyAbandon_MatchesFullScan) {
+		arma::arma_rng::set_seed(10);
+		arma::mat training_set = arma::randn<arma::mat>(40, 600);
+		training_set.each_col() %= arma::linspace<arma::vec>(0.1, 4, 40);
+		arma::Col<label_t> training_labels =
+			arma::randi<arma::Col<label_t>>(600, arma::distr_param(0, 9));
+		arma::mat test_set = arma::randn<arma::mat>(40, 100);
+		test_set.each_col() %= arma::linspace<arma::vec>(0.1, 4, 40);
+
+		for ( uint32_t p = 1; p <= 2; p++ ) {
+			ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(p));
+			nn.set_batched(false);
+			nn.train(training_set, training_labels);
+			arma::Col<label_t> expected;
+			nn.validate(test_set, training_labels.head(100), &expected);
+			EXPECT_EQ(0, nn.get_touched_fraction());
+
+			// The dimensions of largest variance come last in natural order
+			double natural_fraction = 1;
+			for ( bool variance_order : {false, true} ) {
+				nn.set_early_abandon(true, variance_order);
+				nn.train(training_set, training_labels);
+				nn.set_num_threads(3);
+
+				arma::Col<label_t> actual;
+				nn.validate(test_set, training_labels.head(100), &actual);
+				EXPECT_TRUE(arma::all(expected == actual));
+				EXPECT_LT(0, nn.get_touched_fraction());
+				EXPECT_GT(natural_fraction, nn.get_touched_fraction());
+				natural_fraction = nn.get_touched_fraction();
+
+				// Queries are still reordered after disabling the mode
+				nn.set_early_abandon(false);
+				nn.set_batched(p == 2);
+				nn.validate(test_set, training_labels.head(100), &actual);
+				EXPECT_TRUE(arma::all(expected == actual));
+				nn.set_batched(false);
+			}
+		}
+	}
+
+	TEST_F(NearestNeighborTests, Test_Float_MatchesDouble) {
+		arma::arma_rng::set_seed(7);
+		arma::mat training_set = arma::randi<arma::mat>(12, 400,
+			arma::distr_param(0, 255));
+		arma::Col<label_t> training_labels =
+			arma::randi<arma::Col<label_t>>(400, arma::distr_param(0, 9));
+		arma::mat test_set = arma::randi<arma::mat>(12, 90,
+			arma::distr_param(0, 255));
+
+		for ( bool batched : {false, true} ) {
+			ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(2));
+			ocr::FNearestNeighbor fnn = ocr::FNearestNeighbor(new FPNorm(2));
+			nn.set_batched(batched);
+			fnn.set_batched(batched);
+			nn.train(training_set, training_labels);
+			fnn.train(arma::conv_to<arma::fmat>::from(training_set), training_labels);
+
+			// Integer pixels are exact in float, and so are their distances
+			arma::Col<label_t> expected = nn.test(test_set);
+			arma::Col<label_t> actual =
+				fnn.test(arma::conv_to<arma::fmat>::from(test_set));
+			EXPECT_TRUE(arma::all(expected == actual));
+		}
+	}
+
+	TEST_F(NearestNeighborTests, Train_Moved_SamePredictionsAndEmptied) {
+		for ( bool variance_order : {false, true} ) {
+			ocr::NearestNeighbor nn;
+			nn.set_early_abandon(variance_order, variance_order);
+			nn.train(training_set, training_labels);
+
+			arma::mat moved_set = training_set;
+			arma::Col<label_t> moved_labels = training_labels;
+			ocr::NearestNeighbor moved;
+			moved.set_early_abandon(variance_order, variance_order);
+			moved.train(std::move(moved_set), std::move(moved_labels));
+
+			EXPECT_TRUE(moved_set.is_empty());
+			EXPECT_TRUE(moved_labels.is_empty());
+			EXPECT_TRUE(arma::all(predictions(nn) == predictions(moved)));
+		}
+	}
+
+	TEST_F(NearestNeighborTests, TrainView_External_ReadInPlace) {
+		arma::mat external_set = training_set;
+		arma::Col<label_t> external_labels = training_labels;
+		ocr::NearestNeighbor nn;
+		nn.train_view(external_set, external_labels);
+		EXPECT_EQ(training_labels[7], nn.predict(training_set.col(7)));
+
+		// The labels are read from the caller's memory, not from a copy
+		external_labels[7] = 10;
+		EXPECT_EQ(10, nn.predict(training_set.col(7)));
+
+		// Training again does not write through the former views
+		nn.train(test_set, training_labels.head(test_set.n_cols));
+		nn.train(training_set + 1, training_labels + 1);
+		EXPECT_TRUE(arma::approx_equal(training_set, external_set, "absdiff", 0));
+		EXPECT_EQ(10, external_labels[7]);
+		EXPECT_EQ(training_labels[7] + 1, nn.predict(training_set.col(7) + 1));
+	}
+
+	TEST_F(NearestNeighborTests, LoadFile_Mapped_SamePredictions) {
+		ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(1));
+		nn.set_batched(false);
+		nn.set_early_abandon(true, true);
+		nn.train(training_set, training_labels);
+		ASSERT_TRUE(nn.save_file(model_filename));
+
+		// The options are restored along with the training set
+		ocr::NearestNeighbor restored = ocr::NearestNeighbor(new PNorm(1));
+		ASSERT_TRUE(restored.load_file(model_filename));
+		EXPECT_TRUE(arma::all(predictions(nn) == predictions(restored)));
+
+		// Training again releases the mapping
+		restored.train(test_set, training_labels.head(test_set.n_cols));
+		std::remove(model_filename.c_str());
+		EXPECT_TRUE(arma::all(training_labels.head(test_set.n_cols)
+			== predictions(restored)));
+	}
+
+	TEST_F(NearestNeighborTests, Load_Stream_SamePredictions) {
+		ocr::FNearestNeighbor nn = ocr::FNearestNeighbor(new FPNorm(2));
+		nn.train(arma::conv_to<arma::fmat>::from(training_set), training_labels);
+		std::stringstream stream;
+		ASSERT_TRUE(nn.save(stream));
+
+		ocr::FNearestNeighbor restored;
+		ASSERT_TRUE(restored.load(stream));
+		EXPECT_TRUE(arma::all(predictions(nn) == predictions(restored)));
+
+		// A model of another element type is rejected
+		stream.seekg(0);
+		EXPECT_FALSE(ocr::NearestNeighbor().load(stream));
+	}
+
+	TEST_F(NearestNeighborTests, Load_StreamBackToBack_RestoresEach) {
+		ocr::NearestNeighbor first, second;
+		first.train(training_set, training_labels);
+		second.train(test_set, training_labels.head(test_set.n_cols));
+		std::stringstream stream;
+		ASSERT_TRUE(first.save(stream));
+		ASSERT_TRUE(second.save(stream));
+
+		ocr::NearestNeighbor first_restored, second_restored;
+		ASSERT_TRUE(first_restored.load(stream));
+		ASSERT_TRUE(second_restored.load(stream));
+		EXPECT_TRUE(arma::all(predictions(first) == predictions(first_restored)));
+		EXPECT_TRUE(arma::all(predictions(second) == predictions(second_restored)));
+	}
+
+	TEST_F(NearestNeighborTests, Load_Corrupted_Unchanged) {
+		ocr::NearestNeighbor nn;
+		nn.train(training_set, training_labels);
+		std::stringstream stream;
+		ASSERT_TRUE(nn.save(stream));
+		std::string contents = stream.str();
+		contents[contents.size()/2] ^= 1;
+
+		ocr::NearestNeighbor other;
+		other.train(test_set, training_labels.head(test_set.n_cols));
+		std::stringstream corrupted(contents);
+		EXPECT_FALSE(other.load(corrupted));
+		EXPECT_TRUE(arma::all(training_labels.head(test_set.n_cols)
+			== predictions(other)));
+	}
+
+	TEST_F(NearestNeighborTests, Load_OtherPNorm_Unchanged) {
+		ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(1));
+		nn.train(training_set, training_labels);
+		std::stringstream stream;
+		ASSERT_TRUE(nn.save(stream));
+
+		ocr::NearestNeighbor other = ocr::NearestNeighbor(new PNorm(2));
+		other.train(test_set, training_labels.head(test_set.n_cols));
+		EXPECT_FALSE(other.load(stream));
+		EXPECT_TRUE(arma::all(training_labels.head(test_set.n_cols)
+			== predictions(other)));
+	}
+
+	TEST_F(NearestNeighborTests, LoadFile_OtherModel_Fails) {
+		ocr::PCA pca = ocr::PCA(3);
+		pca.solve(training_set);
+		ASSERT_TRUE(pca.save_file(model_filename));
+
+		EXPECT_FALSE(ocr::NearestNeighbor().load_file(model_filename));
+		EXPECT_FALSE(ocr::NearestNeighbor().load_file(
+			"/tmp/ocr_nearest_neighbor_missing.model"));
+	}
+}
@@ -0,0 +1,106 @@
+#include "src/classifier/pipeline.h"
+
+#include <exception>
+
+#include <armadillo>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "src/classifier/k_nearest_neighbor.h"
+#include "src/classifier/nearest_neighbor.h"
+
+namespace ocr {
+	class PipelineTests : public testing::Test {
+	public:
+		void SetUp() {
+			arma::arma_rng::set_seed(3);
+			training_set = arma::randu<arma::mat>(20, 400);
+			training_labels =
+				arma::randi<arma::Col<label_t>>(400, arma::distr_param(0, 9));
+			test_set = arma::randu<arma::mat>(20, 700);
+			test_labels =
+				arma::randi<arma::Col<label_t>>(700, arma::distr_param(0, 9));
+
+			pca = ocr::PCA(6);
+			pca.solve(training_set);
+		}
+
+		void TearDown() {
+
+		}
+
+		arma::mat training_set;
+		arma::Col<label_t> training_labels;
+		arma::mat test_set;
+		arma::Col<label_t> test_labels;
+		ocr::PCA pca;
+	};
+
+	TEST_F(PipelineTests, Constructor_Null_Throws) {
+		ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(2));
+		EXPECT_THROW({ocr::Pipeline(nullptr, &nn);}, std::invalid_argument);
+		EXPECT_THROW({ocr::Pipeline(&pca, nullptr);}, std::invalid_argument);
+	}
+
+	TEST_F(PipelineTests, Test_Blocks_MatchesProjectedTest) {
+		ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(2));
+		ocr::Pipeline pipeline(&pca, &nn);
+		pipeline.train(training_set, training_labels);
+
+		arma::Col<label_t> expected;
+		double expected_error = nn.validate(pca.project(test_set), test_labels,
+			&expected);
+
+		for ( size_t num_threads : {1, 3} ) {
+			pipeline.set_num_threads(num_threads);
+			arma::Col<label_t> actual;
+			double actual_error = pipeline.validate(test_set, test_labels, &actual);
+
+			EXPECT_EQ(expected_error, actual_error);
+			EXPECT_TRUE(arma::all(expected == actual));
+			EXPECT_EQ(1u, nn.get_num_threads());
+		}
+	}
+
+	TEST_F(PipelineTests, TestBatch_Scores_MatchProjectedScores) {
+		ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(2));
+		ocr::Pipeline pipeline(&pca, &nn);
+		pipeline.train(training_set, training_labels);
+
+		arma::Col<label_t> expected;
+		arma::vec expected_distances;
+		nn.test_batch(pca.project(test_set), expected, &expected_distances);
+
+		pipeline.set_num_threads(3);
+		arma::Col<label_t> actual;
+		arma::vec actual_distances;
+		pipeline.test_batch(test_set, actual, &actual_distances);
+		EXPECT_TRUE(arma::all(expected == actual));
+		EXPECT_TRUE(arma::approx_equal(expected_distances, actual_distances,
+			"absdiff", 1e-12));
+	}
+
+	TEST_F(PipelineTests, TestBatch_Throws_RestoresThreads) {
+		ocr::KNearestNeighbor knn = ocr::KNearestNeighbor(3, new PNorm(2));
+		ocr::Pipeline pipeline(&pca, &knn);
+		pipeline.train(arma::mat(20, 0), arma::Col<label_t>());
+
+		knn.set_num_threads(4);
+		pipeline.set_num_threads(3);
+		arma::Col<label_t> labels;
+		EXPECT_THROW({pipeline.test_batch(test_set, labels);}, std::invalid_argument);
+		EXPECT_EQ(4u, knn.get_num_threads());
+	}
+
+	TEST_F(PipelineTests, Predict_Raw_MatchesProjectedPredict) {
+		ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(2));
+		ocr::Pipeline pipeline(&pca, &nn);
+		pipeline.train(training_set, training_labels);
+
+		for ( arma::uword i = 0; i < 20; i++ ) {
+			EXPECT_EQ(nn.predict(arma::vec(pca.project(test_set.col(i)))),
+				pipeline.predict(test_set.col(i)));
+		}
+	}
+}
@@ -0,0 +1,86 @@
+#include "src/classifier/pq_nearest_neighbor.h"
+
+#include <exception>
+
+#include <armadillo>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "src/classifier/nearest_neighbor.h"
+
+namespace ocr {
+	class PQNearestNeighborTests : public testing::Test {
+	public:
+		void SetUp() {
+			// Well separated clusters, each with its own label
+			arma::arma_rng::set_seed(8);
+			arma::mat centers = 10*arma::randn<arma::mat>(16, 10);
+			training_labels =
+				arma::randi<arma::Col<label_t>>(2000, arma::distr_param(0, 9));
+			test_labels =
+				arma::randi<arma::Col<label_t>>(200, arma::distr_param(0, 9));
+			training_set = centers.cols(arma::conv_to<arma::uvec>::from(training_labels))
+				+ arma::randn<arma::mat>(16, 2000);
+			test_set = centers.cols(arma::conv_to<arma::uvec>::from(test_labels))
+				+ arma::randn<arma::mat>(16, 200);
+		}
+
+		void TearDown() {
+
+		}
+
+		arma::mat training_set;
+		arma::Col<label_t> training_labels;
+		arma::mat test_set;
+		arma::Col<label_t> test_labels;
+	};
+
+	TEST_F(PQNearestNeighborTests, Constructor_Empty_Valid) {
+		EXPECT_NO_THROW({ocr::PQNearestNeighbor();});
+	}
+
+	TEST_F(PQNearestNeighborTests, Constructor_InvalidParams_Invalid) {
+		EXPECT_THROW({ocr::PQNearestNeighbor(0);}, std::invalid_argument);
+		EXPECT_THROW({ocr::PQNearestNeighbor(8, 0, 257);}, std::invalid_argument);
+	}
+
+	TEST_F(PQNearestNeighborTests, Train_CompressesTrainingSet) {
+		ocr::PQNearestNeighbor pq = ocr::PQNearestNeighbor(4);
+		pq.train(training_set, training_labels);
+		EXPECT_EQ(4*training_set.n_cols, pq.get_memory_bytes());
+	}
+
+	TEST_F(PQNearestNeighborTests, Validate_ClusteredData_Accurate) {
+		ocr::PQNearestNeighbor pq = ocr::PQNearestNeighbor(4);
+		pq.train(training_set, training_labels);
+		EXPECT_GE(0.05, pq.validate(test_set, test_labels));
+	}
+
+	TEST_F(PQNearestNeighborTests, Test_Rerank_MatchesNearestNeighbor) {
+		ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(2));
+		nn.train(training_set, training_labels);
+		ocr::PQNearestNeighbor pq = ocr::PQNearestNeighbor(8, 100);
+		pq.train(training_set, training_labels);
+
+		arma::Col<label_t> expected, actual;
+		nn.validate(test_set, test_labels, &expected);
+		pq.validate(test_set, test_labels, &actual);
+		EXPECT_LE(0.95, arma::mean(arma::conv_to<arma::vec>::from(expected == actual)));
+	}
+
+	TEST_F(PQNearestNeighborTests, ProductQuantizer_AsymmetricDistance_MatchesDecoded) {
+		ocr::ProductQuantizer quantizer = ocr::ProductQuantizer(4, 16);
+		quantizer.train(training_set);
+		arma::mat reconstructed = quantizer.decode(quantizer.encode(training_set));
+
+		arma::mat table;
+		quantizer.distance_table(test_set.col(0), table);
+		arma::Mat<uint8_t> code = quantizer.encode(training_set.col(0));
+		EXPECT_NEAR(arma::accu(arma::square(test_set.col(0) - reconstructed.col(0))),
+			quantizer.asymmetric_distance(table, code.memptr()), 1e-8);
+		EXPECT_GT(arma::accu(arma::square(training_set)),
+			arma::accu(arma::square(training_set - reconstructed)));
+	}
+
+}
@@ -0,0 +1,108 @@
+#include "src/classifier/quantized_nearest_neighbor.h"
+
+#include <exception>
+
+#include <armadillo>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "src/classifier/nearest_neighbor.h"
+
+namespace ocr {
+	class QuantizedNearestNeighborTests : public testing::Test {
+	public:
+		void SetUp() {
+			// Integer pixels in [0, 255], with lengths that exercise both the
+			// SIMD blocks and the scalar tail of the kernels
+			arma::arma_rng::set_seed(9);
+			training_set = arma::randi<arma::mat>(37, 600, arma::distr_param(0, 255));
+			training_labels =
+				arma::randi<arma::Col<label_t>>(600, arma::distr_param(0, 9));
+			test_set = arma::randi<arma::mat>(37, 150, arma::distr_param(0, 255));
+		}
+
+		void TearDown() {
+
+		}
+
+		arma::mat training_set;
+		arma::Col<label_t> training_labels;
+		arma::mat test_set;
+	};
+
+	TEST_F(QuantizedNearestNeighborTests, Constructor_Empty_Valid) {
+		EXPECT_NO_THROW({ocr::QuantizedNearestNeighbor();});
+	}
+
+	TEST_F(QuantizedNearestNeighborTests, Constructor_InvalidNorm_Invalid) {
+		EXPECT_THROW({ocr::QuantizedNearestNeighbor(
+			ocr::QuantizedNearestNeighbor::UINT8, 3);}, std::invalid_argument);
+		EXPECT_THROW({ocr::QuantizedNearestNeighbor(
+			ocr::QuantizedNearestNeighbor::INT8, 1);}, std::invalid_argument);
+	}
+
+	TEST_F(QuantizedNearestNeighborTests, Test_Uint8_MatchesDouble) {
+		for ( uint32_t p = 1; p <= 2; p++ ) {
+			ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(p));
+			nn.set_batched(false);
+			nn.train(training_set, training_labels);
+			ocr::QuantizedNearestNeighbor qnn = ocr::QuantizedNearestNeighbor(
+				ocr::QuantizedNearestNeighbor::UINT8, p);
+			qnn.train(training_set, training_labels);
+
+			// Distances between integer pixels are exact in both paths
+			arma::Col<label_t> expected;
+			arma::Col<label_t> actual;
+			nn.validate(test_set, arma::zeros<arma::Col<label_t>>(150), &expected);
+			qnn.validate(test_set, arma::zeros<arma::Col<label_t>>(150), &actual);
+			EXPECT_TRUE(arma::all(expected == actual));
+			EXPECT_EQ(training_set.n_elem, qnn.get_memory_bytes());
+		}
+	}
+
+	TEST_F(QuantizedNearestNeighborTests, Test_Int8_AgreesWithDouble) {
+		// Well separated clusters with dimensions of decreasing spread, as
+		// in a PCA projection
+		arma::arma_rng::set_seed(10);
+		arma::vec spread = arma::linspace<arma::vec>(20, 1, 24);
+		arma::mat centers = arma::randn<arma::mat>(24, 10);
+		centers.each_col() %= spread;
+		arma::Col<label_t> test_labels =
+			arma::randi<arma::Col<label_t>>(300, arma::distr_param(0, 9));
+		arma::mat projected_training = centers.cols(
+			arma::conv_to<arma::uvec>::from(training_labels))
+			+ arma::randn<arma::mat>(24, 600);
+		arma::mat projected_test = centers.cols(
+			arma::conv_to<arma::uvec>::from(test_labels))
+			+ arma::randn<arma::mat>(24, 300);
+
+		ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(2));
+		nn.train(projected_training, training_labels);
+		ocr::QuantizedNearestNeighbor qnn = ocr::QuantizedNearestNeighbor(
+			ocr::QuantizedNearestNeighbor::INT8);
+		qnn.train(projected_training, training_labels);
+
+		arma::Col<label_t> expected;
+		arma::Col<label_t> actual;
+		double expected_error = nn.validate(projected_test, test_labels, &expected);
+		double actual_error = qnn.validate(projected_test, test_labels, &actual);
+
+		EXPECT_GT(arma::mean(arma::conv_to<arma::vec>::from(expected == actual)), 0.95);
+		EXPECT_NEAR(expected_error, actual_error, 0.02);
+	}
+
+	TEST_F(QuantizedNearestNeighborTests, TestBatch_Scores_NotMeasured) {
+		ocr::QuantizedNearestNeighbor qnn;
+		qnn.train(training_set, training_labels);
+
+		arma::Col<label_t> labels;
+		arma::vec distances;
+		arma::vec confidence;
+		qnn.test_batch(test_set, labels, &distances, &confidence);
+		EXPECT_TRUE(arma::all(labels == qnn.test(test_set)));
+		EXPECT_EQ(test_set.n_cols, distances.n_elem);
+		EXPECT_TRUE(distances.has_nan());
+		EXPECT_TRUE(confidence.has_nan());
+	}
+}
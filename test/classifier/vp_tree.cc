@@ -0,0 +1,101 @@
+#include "src/classifier/vp_tree.h"
+
+#include <exception>
+
+#include <armadillo>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "src/classifier/nearest_neighbor.h"
+
+namespace ocr {
+	/**
+	 * Chebyshev metric, which the library does not provide, used to check that
+	 * the tree works with arbitrary metrics
+	 */
+	class ChebyshevMetric : public Metric {
+	public:
+		double distance(const arma::vec &vec1, const arma::vec &vec2) {
+			return arma::max(arma::abs(vec1 - vec2));
+		}
+	};
+
+	class VPTreeTests : public testing::Test {
+	public:
+		void SetUp() {
+			arma::arma_rng::set_seed(6);
+			training_set = arma::randn<arma::mat>(3, 2000);
+			training_labels =
+				arma::randi<arma::Col<label_t>>(2000, arma::distr_param(0, 9));
+			test_set = arma::randn<arma::mat>(3, 200);
+		}
+
+		void TearDown() {
+
+		}
+
+		arma::mat training_set;
+		arma::Col<label_t> training_labels;
+		arma::mat test_set;
+	};
+
+	TEST_F(VPTreeTests, Constructor_Empty_Valid) {
+		EXPECT_NO_THROW({ocr::VPTree();});
+	}
+
+	TEST_F(VPTreeTests, Constructor_ZeroK_Invalid) {
+		EXPECT_THROW({ocr::VPTree(new PNorm(), 0);}, std::invalid_argument);
+	}
+
+	TEST_F(VPTreeTests, Test_OneNeighbor_MatchesNearestNeighbor) {
+		std::vector<Metric*> metrics = {new PNorm(1), new PNorm(2),
+			new ChebyshevMetric()};
+		for ( Metric *metric : metrics ) {
+			ocr::NearestNeighbor nn(metric);
+			nn.train(training_set, training_labels);
+
+			ocr::VPTree tree(metric);
+			tree.train(training_set, training_labels);
+
+			arma::Col<label_t> expected, actual;
+			nn.validate(test_set, training_labels.head(200), &expected);
+			tree.validate(test_set, training_labels.head(200), &actual);
+			EXPECT_TRUE(arma::all(expected == actual));
+			delete metric;
+		}
+	}
+
+	TEST_F(VPTreeTests, NearestNeighbors_MatchesSortedDistances) {
+		ocr::VPTree tree(new ChebyshevMetric(), 5);
+		tree.train(training_set, training_labels);
+
+		for ( arma::uword q = 0; q < test_set.n_cols; q++ ) {
+			arma::vec distances = arma::max(arma::abs(
+				training_set.each_col() - test_set.col(q)), 0).t();
+			arma::uvec expected = arma::sort_index(distances);
+
+			std::vector<Neighbor> neighbors = tree.nearest_neighbors(test_set.col(q));
+			ASSERT_EQ(5, neighbors.size());
+			for ( size_t i = 0; i < neighbors.size(); i++ ) {
+				EXPECT_DOUBLE_EQ(distances[expected[i]], neighbors[i].distance);
+			}
+		}
+	}
+
+	TEST_F(VPTreeTests, MeanSkipped_LowDimensional_Positive) {
+		ocr::VPTree tree;
+		tree.train(training_set, training_labels);
+		EXPECT_EQ(0, tree.get_mean_skipped());
+
+		size_t skipped = 0;
+		tree.nearest_neighbors(test_set.col(0), &skipped);
+		EXPECT_LT(0, skipped);
+		EXPECT_GT(training_set.n_cols, skipped);
+		EXPECT_EQ(skipped, tree.get_mean_skipped());
+
+		tree.reset_statistics();
+		EXPECT_EQ(0, tree.get_mean_skipped());
+	}
+
+}
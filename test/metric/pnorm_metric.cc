@@ -49,4 +49,41 @@ namespace ocr {
 		EXPECT_EQ(4, manhattan_metric.distance({1,0,1,0},{0,1,0,1}));
 	}
 
-}
\ No newline at end of file
+	TEST_F(PNormMetricTests, RankDistance_EuclideanParam_Squared) {
+		ocr::PNorm euclidean_metric = ocr::PNorm(2);
+		EXPECT_EQ(4, euclidean_metric.rank_distance({0,0,0,0},{1,1,1,1}));
+		EXPECT_EQ(25, euclidean_metric.rank_distance({3,0},{0,4}));
+	}
+
+	TEST_F(PNormMetricTests, Distance_RandomVectors_MatchesArmadilloNorm) {
+		arma::arma_rng::set_seed(4);
+		for ( uint32_t p = 1; p <= 5; p++ ) {
+			ocr::PNorm metric = ocr::PNorm(p);
+			// Lengths that are not multiples of the SIMD width exercise the
+			// scalar tail of the kernels
+			for ( arma::uword n = 1; n <= 19; n += 3 ) {
+				arma::vec x = arma::randn<arma::vec>(n);
+				arma::vec y = arma::randn<arma::vec>(n);
+				double expected = arma::norm(x - y, p);
+				EXPECT_NEAR(expected, metric.distance(x, y), 1e-12*(1+expected));
+				EXPECT_NEAR(std::pow(expected, p), metric.rank_distance(x, y),
+					1e-10*(1+std::pow(expected, p)));
+			}
+		}
+	}
+
+	TEST_F(PNormMetricTests, Distance_Float_MatchesDouble) {
+		arma::arma_rng::set_seed(5);
+		for ( uint32_t p = 1; p <= 3; p++ ) {
+			ocr::PNorm metric = ocr::PNorm(p);
+			ocr::FPNorm float_metric = ocr::FPNorm(p);
+			for ( arma::uword n = 1; n <= 37; n += 4 ) {
+				arma::fvec x = arma::randn<arma::fvec>(n);
+				arma::fvec y = arma::randn<arma::fvec>(n);
+				double expected = metric.distance(arma::conv_to<arma::vec>::from(x),
+					arma::conv_to<arma::vec>::from(y));
+				EXPECT_NEAR(expected, float_metric.distance(x, y), 1e-5*(1+expected));
+			}
+		}
+	}
+}
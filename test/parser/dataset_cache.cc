@@ -0,0 +1,177 @@
+#include "src/parser/dataset_cache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <armadillo>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "src/util/ocrtypes.h"
+
+namespace ocr {
+	class DatasetCacheTests : public testing::Test {
+	public:
+		void SetUp() {
+			cache_filename = "/tmp/ocr_dataset_cache.cache";
+			source_filename = "/tmp/ocr_dataset_cache_source.idx";
+			std::ofstream(source_filename, std::ios::binary) << "source contents";
+
+			arma::arma_rng::set_seed(8);
+			images = arma::randn<arma::mat>(7, 33);
+			features = arma::randn<arma::fmat>(3, 5);
+			labels = arma::randi<arma::Col<label_t>>(33, arma::distr_param(0, 9));
+		}
+
+		void TearDown() {
+			std::remove(cache_filename.c_str());
+			std::remove(source_filename.c_str());
+		}
+
+		std::string cache_filename;
+		std::string source_filename;
+		arma::mat images;
+		arma::fmat features;
+		arma::Col<label_t> labels;
+	};
+
+	TEST_F(DatasetCacheTests, Constructor_MissingFile_Closed) {
+		ocr::DatasetCache cache("/tmp/ocr_dataset_cache_missing.cache");
+		EXPECT_FALSE(cache.is_open());
+		EXPECT_TRUE(cache.get<double>("images").is_empty());
+	}
+
+	TEST_F(DatasetCacheTests, Write_RoundTrip_AlignedViews) {
+		ocr::DatasetCacheWriter writer;
+		writer.add("images", images);
+		writer.add("features", features);
+		writer.add("labels", labels);
+		ASSERT_TRUE(writer.write(cache_filename, 42));
+
+		ocr::DatasetCache cache(cache_filename);
+		ASSERT_TRUE(cache.is_open());
+		EXPECT_EQ(42u, cache.get_key());
+		EXPECT_TRUE(cache.contains("features"));
+		EXPECT_FALSE(cache.contains("missing"));
+
+		arma::mat cached_images = cache.get<double>("images");
+		EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(cached_images.memptr())
+			% ocr::DatasetCache::kAlignment);
+		EXPECT_TRUE(arma::approx_equal(images, cached_images, "absdiff", 0));
+		EXPECT_TRUE(arma::approx_equal(features, cache.get<float>("features"),
+			"absdiff", 0));
+		EXPECT_TRUE(arma::all(labels == arma::Col<label_t>(cache.get<label_t>("labels"))));
+
+		// A matrix is only returned as the element type it was written with
+		EXPECT_TRUE(cache.get<float>("images").is_empty());
+	}
+
+	TEST_F(DatasetCacheTests, Constructor_Truncated_Closed) {
+		ocr::DatasetCacheWriter writer;
+		writer.add("images", images);
+		ASSERT_TRUE(writer.write(cache_filename, 1));
+
+		std::ifstream file(cache_filename, std::ios::binary);
+		std::string contents((std::istreambuf_iterator<char>(file)),
+			std::istreambuf_iterator<char>());
+		std::ofstream(cache_filename, std::ios::binary | std::ios::trunc)
+			.write(contents.data(), contents.size() - 8);
+
+		EXPECT_FALSE(ocr::DatasetCache(cache_filename).is_open());
+	}
+
+	TEST_F(DatasetCacheTests, Constructor_OverflowingSize_Closed) {
+		ocr::DatasetCacheWriter writer;
+		writer.add("images", images);
+		ASSERT_TRUE(writer.write(cache_filename, 1));
+
+		// Sizes of the first record whose byte count wraps around to zero
+		const uint64_t sizes[] = {uint64_t(1) << 61, 8};
+		std::fstream file(cache_filename,
+			std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(64 + 40);
+		file.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+		file.close();
+
+		EXPECT_FALSE(ocr::DatasetCache(cache_filename).is_open());
+	}
+
+	TEST_F(DatasetCacheTests, Hash_ChangedInputs_ChangesKey) {
+		const uint64_t key = ocr::DatasetCache::hash({source_filename}, "pca:56");
+		EXPECT_EQ(key, ocr::DatasetCache::hash({source_filename}, "pca:56"));
+		EXPECT_NE(key, ocr::DatasetCache::hash({source_filename}, "pca:57"));
+		EXPECT_NE(key, ocr::DatasetCache::hash({"/tmp/ocr_dataset_cache_missing.idx"},
+			"pca:56"));
+
+		std::ofstream(source_filename, std::ios::binary) << "source content!";
+		EXPECT_NE(key, ocr::DatasetCache::hash({source_filename}, "pca:56"));
+	}
+
+	TEST_F(DatasetCacheTests, Write_Stream_RoundTrip) {
+		ocr::DatasetCacheWriter writer;
+		writer.add("images", images);
+		writer.add("labels", labels);
+		std::stringstream stream;
+		ASSERT_TRUE(writer.write(stream, 7));
+
+		ocr::DatasetCache cache(stream);
+		ASSERT_TRUE(cache.is_open());
+		EXPECT_EQ(7u, cache.get_key());
+		EXPECT_TRUE(cache.verify());
+		EXPECT_TRUE(arma::approx_equal(images, cache.get<double>("images"),
+			"absdiff", 0));
+		EXPECT_TRUE(arma::all(labels == arma::Col<label_t>(cache.get<label_t>("labels"))));
+	}
+
+	TEST_F(DatasetCacheTests, Write_StreamBackToBack_ReadInOrder) {
+		ocr::DatasetCacheWriter first, second;
+		first.add("images", images);
+		second.add("features", features);
+		std::stringstream stream;
+		ASSERT_TRUE(first.write(stream, 1));
+		ASSERT_TRUE(second.write(stream, 2));
+		stream << "trailing";
+
+		ocr::DatasetCache first_cache(stream);
+		ASSERT_TRUE(first_cache.is_open());
+		EXPECT_EQ(1u, first_cache.get_key());
+		EXPECT_TRUE(first_cache.verify());
+		EXPECT_TRUE(arma::approx_equal(images, first_cache.get<double>("images"),
+			"absdiff", 0));
+
+		ocr::DatasetCache second_cache(stream);
+		ASSERT_TRUE(second_cache.is_open());
+		EXPECT_EQ(2u, second_cache.get_key());
+		EXPECT_TRUE(second_cache.verify());
+		EXPECT_FALSE(second_cache.contains("images"));
+		EXPECT_TRUE(arma::approx_equal(features, second_cache.get<float>("features"),
+			"absdiff", 0));
+
+		std::string rest;
+		stream >> rest;
+		EXPECT_EQ("trailing", rest);
+	}
+
+	TEST_F(DatasetCacheTests, Verify_CorruptedData_Fails) {
+		ocr::DatasetCacheWriter writer;
+		writer.add("images", images);
+		ASSERT_TRUE(writer.write(cache_filename, 1));
+		ASSERT_TRUE(ocr::DatasetCache(cache_filename).verify());
+
+		std::fstream file(cache_filename,
+			std::ios::binary | std::ios::in | std::ios::out);
+		file.seekg(-1, std::ios::end);
+		char last = file.get();
+		file.seekp(-1, std::ios::end);
+		file.put(last ^ 1);
+		file.close();
+
+		// The layout is intact, so the cache still opens
+		ocr::DatasetCache cache(cache_filename);
+		EXPECT_TRUE(cache.is_open());
+		EXPECT_FALSE(cache.verify());
+	}
+}
@@ -0,0 +1,161 @@
+#include "src/parser/dataset_stream.h"
+
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <string>
+
+#include <armadillo>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "src/classifier/nearest_neighbor.h"
+#include "src/parser/dataset_loader.h"
+#include "src/parser/mnist_parser.h"
+
+namespace ocr {
+	class DatasetStreamTests : public testing::Test {
+	public:
+		void SetUp() {
+			images_filename = "/tmp/ocr_dataset_stream_images.idx";
+			labels_filename = "/tmp/ocr_dataset_stream_labels.idx";
+
+			arma::arma_rng::set_seed(3);
+			images = arma::randi<arma::Mat<uint8_t>>(6, 103, arma::distr_param(0, 255));
+			labels = arma::randi<arma::Col<uint8_t>>(103, arma::distr_param(0, 3));
+			write(images_filename, images);
+			write(labels_filename, labels.t());
+		}
+
+		void TearDown() {
+			std::remove(images_filename.c_str());
+			std::remove(labels_filename.c_str());
+		}
+
+		/**
+		 * Writes an unsigned byte IDX file with an entry in each column
+		 */
+		void write( const std::string &filename, const arma::Mat<uint8_t> &data ) {
+			std::ofstream file(filename, std::ios::binary);
+			const char header[] = {0, 0, 0x08, 2,
+				0, 0, 0, static_cast<char>(data.n_cols),
+				0, 0, 0, static_cast<char>(data.n_rows)};
+			file.write(header, sizeof(header));
+			file.write(reinterpret_cast<const char*>(data.memptr()), data.n_elem);
+		}
+
+		std::string images_filename;
+		std::string labels_filename;
+		arma::Mat<uint8_t> images;
+		arma::Col<uint8_t> labels;
+	};
+
+	TEST_F(DatasetStreamTests, Constructor_ZeroBatch_Invalid) {
+		EXPECT_THROW({ocr::DatasetStream(images_filename, "", 0);},
+			std::invalid_argument);
+	}
+
+	TEST_F(DatasetStreamTests, Constructor_MissingLabels_Closed) {
+		ocr::DatasetStream stream(images_filename, "/tmp/ocr_dataset_stream_missing.idx");
+		EXPECT_FALSE(stream.is_open());
+		arma::mat batch;
+		EXPECT_FALSE(stream.next(batch));
+	}
+
+	TEST_F(DatasetStreamTests, Next_Prefetch_YieldsEveryBatch) {
+		for ( bool prefetch : {false, true} ) {
+			ocr::DatasetStream stream(images_filename, labels_filename, 25, prefetch);
+			ASSERT_TRUE(stream.is_open());
+			EXPECT_EQ(103u, stream.num_entries());
+			EXPECT_EQ(6u, stream.entry_size());
+
+			arma::mat batch;
+			arma::Col<label_t> batch_labels;
+			arma::uword first = 0;
+			size_t num_batches = 0;
+			while ( stream.next(batch, &batch_labels) ) {
+				arma::uword last = first + batch.n_cols - 1;
+				EXPECT_TRUE(arma::approx_equal(batch,
+					arma::conv_to<arma::mat>::from(images.cols(first, last)), "absdiff", 0));
+				EXPECT_TRUE(arma::all(batch_labels ==
+					arma::conv_to<arma::Col<label_t>>::from(labels.rows(first, last))));
+				first = last + 1;
+				num_batches++;
+			}
+			EXPECT_EQ(103u, first);
+			EXPECT_EQ(5u, num_batches);
+		}
+	}
+
+	TEST_F(DatasetStreamTests, Reset_AfterRead_RestartsStream) {
+		ocr::DatasetStream stream(images_filename, "", 40);
+		arma::mat first_batch;
+		arma::mat batch;
+		ASSERT_TRUE(stream.next(first_batch));
+		ASSERT_TRUE(stream.next(batch));
+		stream.reset();
+		ASSERT_TRUE(stream.next(batch));
+		EXPECT_TRUE(arma::approx_equal(first_batch, batch, "absdiff", 0));
+	}
+
+	TEST_F(DatasetStreamTests, Validate_Stream_MatchesMatrix) {
+		arma::arma_rng::set_seed(4);
+		arma::mat training_set = arma::randu<arma::mat>(6, 300)*255;
+		arma::Col<label_t> training_labels =
+			arma::randi<arma::Col<label_t>>(300, arma::distr_param(0, 3));
+
+		ocr::NearestNeighbor nn = ocr::NearestNeighbor(new PNorm(2));
+		nn.train(training_set, training_labels);
+
+		arma::Col<label_t> expected;
+		double expected_error = nn.validate(ocr::mnist::parse_images(images_filename),
+			ocr::mnist::parse_labels(labels_filename), &expected);
+
+		ocr::DatasetStream stream(images_filename, labels_filename, 16);
+		arma::Col<label_t> actual;
+		EXPECT_DOUBLE_EQ(expected_error, nn.validate(stream, &actual));
+		EXPECT_TRUE(arma::all(expected == actual));
+	}
+
+	TEST_F(DatasetStreamTests, DatasetLoader_Concurrent_MatchesParser) {
+		ocr::DatasetLoader loader(2);
+		std::future<arma::mat> loaded_images = loader.load_images(images_filename);
+		std::future<arma::Col<label_t>> loaded_labels = loader.load_labels(labels_filename);
+		EXPECT_TRUE(arma::approx_equal(ocr::mnist::parse_images(images_filename),
+			loaded_images.get(), "absdiff", 0));
+		EXPECT_TRUE(arma::all(ocr::mnist::parse_labels(labels_filename)
+			== loaded_labels.get()));
+	}
+
+	TEST_F(DatasetStreamTests, Validate_Unlabelled_Invalid) {
+		ocr::NearestNeighbor nn = ocr::NearestNeighbor();
+		ocr::DatasetStream stream(images_filename);
+		EXPECT_THROW({nn.validate(stream);}, std::invalid_argument);
+	}
+
+	TEST_F(DatasetStreamTests, Next_Float_MatchesDouble) {
+		ocr::FDatasetStream stream(images_filename, labels_filename, 25);
+		ASSERT_TRUE(stream.is_open());
+
+		arma::fmat batch;
+		arma::Col<label_t> batch_labels;
+		arma::uword first = 0;
+		while ( stream.next(batch, &batch_labels) ) {
+			arma::uword last = first + batch.n_cols - 1;
+			EXPECT_TRUE(arma::approx_equal(batch,
+				arma::conv_to<arma::fmat>::from(images.cols(first, last)), "absdiff", 0));
+			first = last + 1;
+		}
+		EXPECT_EQ(103u, first);
+	}
+
+	TEST_F(DatasetStreamTests, DatasetLoader_Float_MatchesParser) {
+		ocr::DatasetLoader loader(1);
+		std::future<arma::fmat> loaded_images =
+			loader.load_images<float>(images_filename);
+		EXPECT_TRUE(arma::approx_equal(
+			arma::conv_to<arma::fmat>::from(ocr::mnist::parse_images(images_filename)),
+			loaded_images.get(), "absdiff", 0));
+	}
+}
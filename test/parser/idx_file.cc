@@ -0,0 +1,269 @@
+#include "src/parser/idx_file.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include <armadillo>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+#include "src/parser/mnist_parser.h"
+
+namespace ocr {
+	class IdxFileTests : public testing::Test {
+	public:
+		void SetUp() {
+			images_filename = "/tmp/ocr_idx_file_images.idx";
+			labels_filename = "/tmp/ocr_idx_file_labels.idx";
+
+			// Three 2x3 images whose pixels count up from 0
+			std::ofstream images(images_filename, std::ios::binary);
+			const char images_header[] = {0, 0, 0x08, 3, 0, 0, 0, 3,
+				0, 0, 0, 2, 0, 0, 0, 3};
+			images.write(images_header, sizeof(images_header));
+			for ( char pixel = 0; pixel < 18; pixel++ ) {
+				images.put(pixel);
+			}
+
+			std::ofstream labels(labels_filename, std::ios::binary);
+			const char labels_header[] = {0, 0, 0x08, 1, 0, 0, 0, 3};
+			labels.write(labels_header, sizeof(labels_header));
+			labels.put(7).put(2).put(9);
+		}
+
+		void TearDown() {
+			std::remove(images_filename.c_str());
+			std::remove(labels_filename.c_str());
+		}
+
+		/**
+		 * Writes a one-dimensional file of big-endian elements
+		 */
+		void write_vector( const std::string &filename, uint8_t type,
+						   const std::vector<uint8_t> &payload, uint32_t size ) {
+			std::ofstream file(filename, std::ios::binary);
+			const char header[] = {0, 0, static_cast<char>(type), 1, 0, 0, 0,
+				static_cast<char>(size)};
+			file.write(header, sizeof(header));
+			file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+		}
+
+		/**
+		 * Compresses a file with gzip
+		 */
+		void compress( const std::string &filename, const std::string &compressed ) {
+			std::ifstream file(filename, std::ios::binary);
+			std::string contents((std::istreambuf_iterator<char>(file)),
+				std::istreambuf_iterator<char>());
+			gzFile output = gzopen(compressed.c_str(), "wb");
+			gzwrite(output, contents.data(), contents.size());
+			gzclose(output);
+		}
+
+		std::string images_filename;
+		std::string labels_filename;
+	};
+
+	TEST_F(IdxFileTests, Constructor_MissingFile_Closed) {
+		ocr::IdxFile file("/tmp/ocr_idx_file_missing.idx");
+		EXPECT_FALSE(file.is_open());
+		EXPECT_TRUE(file.bytes().is_empty());
+		EXPECT_TRUE(ocr::mnist::parse_images("/tmp/ocr_idx_file_missing.idx").is_empty());
+	}
+
+	TEST_F(IdxFileTests, Constructor_Truncated_Closed) {
+		std::ofstream(images_filename, std::ios::binary | std::ios::trunc)
+			.write("\0\0\x08\x03\0\0\0\x03", 8);
+		ocr::IdxFile file(images_filename);
+		EXPECT_FALSE(file.is_open());
+	}
+
+	TEST_F(IdxFileTests, Constructor_OverflowingDimensions_Closed) {
+		// Four dimensions of 2^16 elements, whose product wraps around to
+		// zero, in a 20-byte file
+		std::ofstream(images_filename, std::ios::binary | std::ios::trunc)
+			.write("\0\0\x08\x04\0\x01\0\0\0\x01\0\0\0\x01\0\0\0\x01\0\0", 20);
+		EXPECT_FALSE(ocr::IdxFile(images_filename).is_open());
+		EXPECT_TRUE(ocr::mnist::parse_images(images_filename).is_empty());
+
+		// A dimension of 2^32-1 shorts in a 12-byte file
+		std::ofstream(images_filename, std::ios::binary | std::ios::trunc)
+			.write("\0\0\x0B\x01\xFF\xFF\xFF\xFF\0\0\0\0", 12);
+		EXPECT_FALSE(ocr::IdxFile(images_filename).is_open());
+	}
+
+	TEST_F(IdxFileTests, Constructor_Images_ParsesHeader) {
+		ocr::IdxFile file(images_filename);
+		ASSERT_TRUE(file.is_open());
+		EXPECT_EQ(ocr::IdxFile::kUnsignedByte, file.get_type());
+		EXPECT_EQ(3u, file.get_dimensions().size());
+		EXPECT_EQ(3u, file.num_entries());
+		EXPECT_EQ(6u, file.entry_size());
+	}
+
+	TEST_F(IdxFileTests, Bytes_Images_ZeroCopyView) {
+		ocr::IdxFile file(images_filename);
+		arma::Mat<uint8_t> pixels = file.bytes();
+		EXPECT_EQ(file.data(), pixels.memptr());
+		EXPECT_EQ(6u, pixels.n_rows);
+		EXPECT_EQ(3u, pixels.n_cols);
+		EXPECT_EQ(13, pixels(1, 2));
+	}
+
+	TEST_F(IdxFileTests, ToMatrix_Range_MatchesFullConversion) {
+		ocr::IdxFile file(images_filename);
+		arma::mat images = file.to_matrix<double>();
+		arma::fmat block = file.to_matrix<float>(1, 5);
+		EXPECT_TRUE(arma::approx_equal(images, ocr::mnist::parse_images(images_filename),
+			"absdiff", 0));
+		EXPECT_EQ(2u, block.n_cols);
+		EXPECT_TRUE(arma::approx_equal(arma::conv_to<arma::fmat>::from(images.cols(1, 2)),
+			block, "absdiff", 0));
+	}
+
+	TEST_F(IdxFileTests, Constructor_UnknownType_Closed) {
+		write_vector(labels_filename, 0x0A, {1, 2, 3}, 3);
+		ocr::IdxFile file(labels_filename);
+		EXPECT_FALSE(file.is_open());
+	}
+
+	TEST_F(IdxFileTests, ToVector_SignedByte_Valid) {
+		write_vector(labels_filename, ocr::IdxFile::kSignedByte, {0xFF, 0x05}, 2);
+		ocr::IdxFile file(labels_filename);
+		std::vector<int8_t> values(2);
+		file.convert(values.data(), 0, 2);
+		EXPECT_EQ(-1, values[0]);
+		EXPECT_EQ(5, values[1]);
+		EXPECT_EQ(-1.0, file.to_vector<double>()(0));
+	}
+
+	TEST_F(IdxFileTests, ToVector_Short_ByteSwapped) {
+		write_vector(labels_filename, ocr::IdxFile::kShort, {0x01, 0x02, 0xFF, 0xFE}, 2);
+		ocr::IdxFile file(labels_filename);
+		EXPECT_EQ(2u, file.element_size());
+		arma::Col<int16_t> values = file.to_vector<int16_t>();
+		EXPECT_EQ(0x0102, values(0));
+		EXPECT_EQ(-2, values(1));
+		arma::vec converted = file.to_vector<double>();
+		EXPECT_EQ(258.0, converted(0));
+		EXPECT_EQ(-2.0, converted(1));
+	}
+
+	TEST_F(IdxFileTests, ToVector_Int_ByteSwapped) {
+		write_vector(labels_filename, ocr::IdxFile::kInt,
+			{0x00, 0x01, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFD}, 2);
+		ocr::IdxFile file(labels_filename);
+		arma::Col<int32_t> values = file.to_vector<int32_t>();
+		EXPECT_EQ(65536, values(0));
+		EXPECT_EQ(-3, values(1));
+	}
+
+	TEST_F(IdxFileTests, ToVector_Float_ByteSwapped) {
+		// 1.5f is 0x3FC00000 and -2.0f is 0xC0000000
+		write_vector(labels_filename, ocr::IdxFile::kFloat,
+			{0x3F, 0xC0, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00}, 2);
+		ocr::IdxFile file(labels_filename);
+		arma::fvec values = file.to_vector<float>();
+		EXPECT_EQ(1.5f, values(0));
+		EXPECT_EQ(-2.0f, values(1));
+		EXPECT_EQ(1.5, file.to_vector<double>()(0));
+	}
+
+	TEST_F(IdxFileTests, ToVector_Double_ByteSwapped) {
+		// 0.25 is 0x3FD0000000000000
+		write_vector(labels_filename, ocr::IdxFile::kDouble,
+			{0x3F, 0xD0, 0, 0, 0, 0, 0, 0}, 1);
+		ocr::IdxFile file(labels_filename);
+		EXPECT_EQ(0.25, file.to_vector<double>()(0));
+		EXPECT_EQ(0.25f, file.to_vector<float>()(0));
+	}
+
+	TEST_F(IdxFileTests, Constructor_Gzip_ParsesHeader) {
+		const std::string compressed = images_filename + ".gz";
+		compress(images_filename, compressed);
+		ocr::IdxFile file(compressed);
+		std::remove(compressed.c_str());
+
+		ASSERT_TRUE(file.is_open());
+		EXPECT_TRUE(file.is_compressed());
+		EXPECT_EQ(nullptr, file.data());
+		EXPECT_TRUE(file.bytes().is_empty());
+		EXPECT_EQ(3u, file.num_entries());
+		EXPECT_EQ(6u, file.entry_size());
+	}
+
+	TEST_F(IdxFileTests, ToMatrix_Gzip_MatchesUncompressed) {
+		// Spans several chunks so that inflation and conversion overlap
+		arma::arma_rng::set_seed(7);
+		arma::Mat<uint8_t> pixels =
+			arma::randi<arma::Mat<uint8_t>>(1000, 3000, arma::distr_param(0, 255));
+		std::ofstream images(images_filename, std::ios::binary | std::ios::trunc);
+		images.write("\0\0\x08\x02\0\0\x0B\xB8\0\0\x03\xE8", 12);
+		images.write(reinterpret_cast<const char*>(pixels.memptr()), pixels.n_elem);
+		images.close();
+
+		const std::string compressed = images_filename + ".gz";
+		compress(images_filename, compressed);
+		ocr::IdxFile file(compressed);
+		ASSERT_TRUE(file.is_open());
+
+		arma::mat expected = arma::conv_to<arma::mat>::from(pixels);
+		EXPECT_TRUE(arma::approx_equal(expected,
+			ocr::mnist::parse_images(compressed), "absdiff", 0));
+		EXPECT_TRUE(arma::approx_equal(expected.cols(2500, 2999),
+			file.to_matrix<double>(2500), "absdiff", 0));
+		// Reading backwards rewinds the inflation
+		EXPECT_TRUE(arma::approx_equal(expected.cols(10, 19),
+			file.to_matrix<double>(10, 10), "absdiff", 0));
+		std::remove(compressed.c_str());
+	}
+
+	TEST_F(IdxFileTests, Constructor_GzipTruncated_Closed) {
+		const std::string compressed = images_filename + ".gz";
+		compress(images_filename, compressed);
+		std::ifstream file(compressed, std::ios::binary);
+		std::string contents((std::istreambuf_iterator<char>(file)),
+			std::istreambuf_iterator<char>());
+		std::ofstream(compressed, std::ios::binary | std::ios::trunc)
+			.write(contents.data(), contents.size() - 6);
+
+		EXPECT_FALSE(ocr::IdxFile(compressed).is_open());
+		EXPECT_TRUE(ocr::mnist::parse_images(compressed).is_empty());
+		std::remove(compressed.c_str());
+	}
+
+	TEST_F(IdxFileTests, Constructor_GzipOversized_Closed) {
+		// A header claiming 2^32 bytes of pixels, whose size modulo 2^32
+		// matches the 12 bytes actually compressed
+		std::ofstream(images_filename, std::ios::binary | std::ios::trunc)
+			.write("\0\0\x08\x02\0\x01\0\0\0\x01\0\0", 12);
+		const std::string compressed = images_filename + ".gz";
+		compress(images_filename, compressed);
+
+		EXPECT_FALSE(ocr::IdxFile(compressed).is_open());
+		EXPECT_TRUE(ocr::mnist::parse_images(compressed).is_empty());
+		std::remove(compressed.c_str());
+	}
+
+	TEST_F(IdxFileTests, ParseLabels_Gzip_Valid) {
+		const std::string compressed = labels_filename + ".gz";
+		compress(labels_filename, compressed);
+		arma::Col<label_t> labels = ocr::mnist::parse_labels(compressed);
+		std::remove(compressed.c_str());
+		ASSERT_EQ(3u, labels.n_elem);
+		EXPECT_EQ(9, labels(2));
+	}
+
+	TEST_F(IdxFileTests, ParseLabels_Labels_Valid) {
+		arma::Col<label_t> labels = ocr::mnist::parse_labels(labels_filename);
+		ASSERT_EQ(3u, labels.n_elem);
+		EXPECT_EQ(7, labels(0));
+		EXPECT_EQ(2, labels(1));
+		EXPECT_EQ(9, labels(2));
+	}
+}
@@ -0,0 +1,269 @@
+#include "src/util/principle_component_analysis.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <armadillo>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+namespace ocr {
+	class PCATests : public testing::Test {
+	public:
+		void SetUp() {
+			arma::arma_rng::set_seed(6);
+			arma::mat basis = arma::randn<arma::mat>(10, 10);
+			arma::vec scale = arma::linspace<arma::vec>(10, 1, 10);
+			dataset = arma::floor(128 + 10*basis*arma::diagmat(scale)
+				*arma::randn<arma::mat>(10, 500)/10);
+			dataset = arma::clamp(dataset, 0, 255);
+		}
+
+		void TearDown() {
+
+		}
+
+		/**
+		 * Writes a double precision IDX file with an entry in each column
+		 */
+		void write( const std::string &filename, const arma::mat &data ) {
+			std::ofstream file(filename, std::ios::binary);
+			const uint32_t dimensions[] = {
+				__builtin_bswap32(data.n_cols), __builtin_bswap32(data.n_rows)};
+			file.write("\0\0\x0E\x02", 4);
+			file.write(reinterpret_cast<const char*>(dimensions), sizeof(dimensions));
+			for ( double value : data ) {
+				uint64_t bits;
+				memcpy(&bits, &value, sizeof(bits));
+				bits = __builtin_bswap64(bits);
+				file.write(reinterpret_cast<const char*>(&bits), sizeof(bits));
+			}
+		}
+
+		/**
+		 * Direct evaluation of Minka's evidence for every k, for reference
+		 */
+		size_t direct_dimensions( const arma::vec &eigenvalues, size_t n_samples ) {
+			const size_t d = eigenvalues.n_rows;
+			const double N = n_samples;
+			arma::vec likelihood = arma::vec(d);
+			likelihood[0] = -DBL_MAX;
+			for ( size_t k = 1; k < d; k++ ) {
+				double v = arma::mean(eigenvalues.rows(k, d-1));
+				arma::vec estimate = eigenvalues;
+				estimate.rows(k, d-1).fill(v);
+
+				size_t m = (size_t)(d*k - k*(k-1)/2.0);
+				double pD = 1./2*k*log(2.) + (m+k)/2.*log(2*M_PI) - k/2.*log(N);
+				for ( size_t i = 1; i <= k; i++ ) {
+					double l = (d - i + 1.)/2;
+					pD += lgamma(l) - l*log(M_PI) - N/2*log(eigenvalues[i-1]);
+				}
+				pD -= N*(d-k)/2.*log(v);
+
+				double log_det_Az = 0;
+				for ( size_t i = 1; i <= k; i++ ) {
+					for ( size_t j = i+1; j <= d; j++ ) {
+						log_det_Az += log((1/estimate[j-1] - 1/estimate[i-1])
+							* (eigenvalues[i-1] - eigenvalues[j-1])) + log(N);
+					}
+				}
+				likelihood[k] = pD - log_det_Az/2;
+			}
+			return likelihood.index_max();
+		}
+
+		arma::mat dataset;
+	};
+
+	TEST_F(PCATests, Solve_Stream_MatchesMatrix) {
+		const std::string filename = "/tmp/ocr_pca_dataset.idx";
+		write(filename, dataset);
+
+		ocr::PCA expected = ocr::PCA(4);
+		expected.solve(dataset);
+
+		ocr::DatasetStream stream(filename, "", 64);
+		ocr::PCA actual = ocr::PCA(4);
+		actual.solve(stream);
+		std::remove(filename.c_str());
+
+		EXPECT_EQ(4u, actual.get_dimensions());
+		EXPECT_NEAR(expected.get_percent_variability(),
+			actual.get_percent_variability(), 1e-9);
+
+		// Compare the projectors, which do not depend on eigenvector signs
+		arma::mat identity = arma::eye<arma::mat>(10, 10);
+		EXPECT_TRUE(arma::approx_equal(expected.project(expected.project(identity), true),
+			actual.project(actual.project(identity), true), "absdiff", 1e-8));
+	}
+
+	TEST_F(PCATests, Solve_Covariance_MatchesSvd) {
+		ocr::PCA svd = ocr::PCA(0.9);
+		svd.set_solver(ocr::PCA::SVD_SOLVER);
+		svd.solve(dataset);
+
+		ocr::PCA covariance = ocr::PCA(0.9);
+		EXPECT_EQ(ocr::PCA::AUTO_SOLVER, covariance.get_solver());
+		covariance.solve(dataset);
+
+		EXPECT_EQ(svd.get_dimensions(), covariance.get_dimensions());
+		EXPECT_NEAR(svd.get_percent_variability(),
+			covariance.get_percent_variability(), 1e-9);
+
+		arma::mat identity = arma::eye<arma::mat>(10, 10);
+		EXPECT_TRUE(arma::approx_equal(svd.project(svd.project(identity), true),
+			covariance.project(covariance.project(identity), true), "absdiff", 1e-8));
+	}
+
+	TEST_F(PCATests, Solve_Randomized_MatchesExact) {
+		ocr::PCA exact = ocr::PCA(3);
+		exact.solve(dataset);
+		EXPECT_NEAR(0.0, exact.subspace_distance(exact), 1e-7);
+
+		ocr::PCA randomized = ocr::PCA(3);
+		randomized.set_solver(ocr::PCA::RANDOMIZED_SOLVER);
+		randomized.solve(dataset);
+
+		EXPECT_EQ(3u, randomized.get_dimensions());
+		EXPECT_NEAR(exact.get_percent_variability(),
+			randomized.get_percent_variability(), 1e-6);
+		EXPECT_LT(randomized.subspace_distance(exact), 1e-4);
+	}
+
+	TEST_F(PCATests, Solve_RandomizedPercentVariability_FallsBack) {
+		ocr::PCA exact = ocr::PCA(0.8);
+		exact.solve(dataset);
+
+		ocr::PCA randomized = ocr::PCA(0.8);
+		randomized.set_solver(ocr::PCA::RANDOMIZED_SOLVER);
+		randomized.solve(dataset);
+
+		EXPECT_EQ(exact.get_dimensions(), randomized.get_dimensions());
+		EXPECT_NEAR(0.0, randomized.subspace_distance(exact), 1e-7);
+	}
+
+	TEST_F(PCATests, Update_Batches_MatchesSolve) {
+		ocr::PCA exact = ocr::PCA(3);
+		exact.solve(dataset);
+
+		ocr::PCA incremental = ocr::PCA(3);
+		for ( size_t first = 0; first < dataset.n_cols; first += 64 ) {
+			size_t last = std::min<size_t>(first + 64, dataset.n_cols) - 1;
+			incremental.update(dataset.cols(first, last));
+		}
+
+		EXPECT_EQ(500u, incremental.get_num_samples());
+		EXPECT_EQ(3u, incremental.get_dimensions());
+		EXPECT_NEAR(exact.get_percent_variability(),
+			incremental.get_percent_variability(), 1e-9);
+		EXPECT_LT(incremental.subspace_distance(exact), 1e-6);
+	}
+
+	TEST_F(PCATests, Update_ShortFirstBatch_DefersProjection) {
+		ocr::PCA exact = ocr::PCA(5);
+		exact.solve(dataset);
+
+		// A first batch of 3 entries cannot span 5 dimensions
+		ocr::PCA incremental = ocr::PCA(5);
+		ASSERT_NO_THROW({incremental.update(dataset.cols(0, 2));});
+		EXPECT_TRUE(incremental.get_projection_matrix().is_empty());
+
+		incremental.update(dataset.cols(3, dataset.n_cols-1));
+		EXPECT_EQ(5u, incremental.get_dimensions());
+		EXPECT_LT(incremental.subspace_distance(exact), 1e-6);
+	}
+
+	TEST_F(PCATests, Update_Stream_MatchesSolve) {
+		const std::string filename = "/tmp/ocr_pca_dataset.idx";
+		write(filename, dataset);
+
+		ocr::PCA exact = ocr::PCA(0.7);
+		exact.solve(dataset);
+
+		// Retaining fewer components than the dataset has only approximates
+		// the discarded spectrum
+		ocr::DatasetStream stream(filename, "", 100);
+		ocr::PCA incremental = ocr::PCA(0.7);
+		incremental.set_retained_components(8);
+		incremental.update(stream);
+		std::remove(filename.c_str());
+
+		EXPECT_EQ(exact.get_dimensions(), incremental.get_dimensions());
+		EXPECT_NEAR(exact.get_percent_variability(),
+			incremental.get_percent_variability(), 1e-3);
+		EXPECT_LT(incremental.subspace_distance(exact), 1e-2);
+	}
+
+	TEST_F(PCATests, Update_AutoDimension_Invalid) {
+		ocr::PCA pca = ocr::PCA();
+		EXPECT_THROW({pca.update(dataset);}, std::invalid_argument);
+	}
+
+	TEST_F(PCATests, Solve_Auto_MatchesDirectEvidence) {
+		arma::arma_rng::set_seed(9);
+		arma::vec scale = arma::join_cols(arma::linspace<arma::vec>(20, 10, 6),
+			arma::ones<arma::vec>(34));
+		arma::mat wide = arma::diagmat(scale)*arma::randn<arma::mat>(40, 2000);
+
+		arma::mat centered = wide.each_col() - arma::mean(wide, 1);
+		arma::vec eigenvalues = arma::square(arma::svd(centered))/wide.n_rows;
+
+		ocr::PCA pca = ocr::PCA();
+		pca.solve(wide);
+		EXPECT_EQ(direct_dimensions(eigenvalues, wide.n_cols), pca.get_dimensions());
+		EXPECT_EQ(6u, pca.get_dimensions());
+	}
+
+	TEST_F(PCATests, SetProjectionMatrix_Restored_SameProjection) {
+		arma::arma_rng::set_seed(6);
+		arma::mat data = arma::randu<arma::mat>(12, 200);
+		ocr::PCA pca = ocr::PCA(4);
+		pca.solve(data);
+
+		ocr::PCA restored;
+		restored.set_projection_matrix(pca.get_projection_matrix());
+
+		EXPECT_EQ(4u, restored.get_dimensions());
+		EXPECT_TRUE(arma::approx_equal(pca.project(data), restored.project(data),
+			"absdiff", 0));
+	}
+
+	TEST_F(PCATests, Solve_Float_MatchesDouble) {
+		arma::arma_rng::set_seed(8);
+		arma::mat data = arma::randn<arma::mat>(10, 400)
+			% arma::repmat(arma::linspace<arma::vec>(10, 1, 10), 1, 400);
+
+		ocr::PCA pca = ocr::PCA(3);
+		pca.solve(data);
+		ocr::FPCA fpca = ocr::FPCA(3);
+		fpca.solve(arma::conv_to<arma::fmat>::from(data));
+
+		ASSERT_EQ(3u, fpca.get_dimensions());
+		arma::vec cosines = arma::svd(pca.get_projection_matrix()
+			* arma::conv_to<arma::mat>::from(fpca.get_projection_matrix()).t());
+		EXPECT_GT(cosines.min(), 1 - 1e-4);
+		EXPECT_NEAR(pca.get_percent_variability(), fpca.get_percent_variability(), 1e-5);
+	}
+
+	TEST_F(PCATests, Load_Stream_SameProjection) {
+		ocr::PCA pca = ocr::PCA(0.9);
+		pca.solve(dataset);
+		std::stringstream stream;
+		ASSERT_TRUE(pca.save(stream));
+
+		ocr::PCA restored = ocr::PCA(2);
+		ASSERT_TRUE(restored.load(stream));
+		EXPECT_EQ(pca.get_dimensions(), restored.get_dimensions());
+		EXPECT_EQ(pca.get_percent_variability(), restored.get_percent_variability());
+		EXPECT_TRUE(arma::approx_equal(pca.project(dataset),
+			restored.project(dataset), "absdiff", 0));
+	}
+}
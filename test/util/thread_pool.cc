@@ -0,0 +1,57 @@
+#include "src/util/thread_pool.h"
+
+#include <atomic>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+
+namespace ocr {
+	class ThreadPoolTests : public testing::Test {
+	public:
+		void SetUp() {
+
+		}
+
+		void TearDown() {
+
+		}
+	};
+
+	TEST_F(ThreadPoolTests, Constructor_Zero_AllCores) {
+		ocr::utilities::ThreadPool pool(0);
+		EXPECT_GE(pool.size(), 1u);
+	}
+
+	TEST_F(ThreadPoolTests, Submit_ManyTasks_ReturnsEachResult) {
+		ocr::utilities::ThreadPool pool(3);
+		std::vector<std::future<int>> results;
+		for ( int i = 0; i < 100; i++ ) {
+			results.push_back(pool.submit([i]() { return i*i; }));
+		}
+		for ( int i = 0; i < 100; i++ ) {
+			EXPECT_EQ(i*i, results[i].get());
+		}
+	}
+
+	TEST_F(ThreadPoolTests, Submit_Throws_PropagatesToFuture) {
+		ocr::utilities::ThreadPool pool(2);
+		std::future<int> result = pool.submit([]() -> int {
+			throw std::runtime_error("failed");
+		});
+		EXPECT_THROW({result.get();}, std::runtime_error);
+	}
+
+	TEST_F(ThreadPoolTests, Destructor_Queued_FinishesEveryTask) {
+		std::atomic<int> count(0);
+		{
+			ocr::utilities::ThreadPool pool(2);
+			for ( int i = 0; i < 50; i++ ) {
+				pool.submit([&count]() { count++; });
+			}
+		}
+		EXPECT_EQ(50, count.load());
+	}
+}